@@ -3,6 +3,7 @@
 #include "../source/Result.h"
 #include "../source/routines.h"
 #include "../source/Input.h"
+#include "../source/TightBinding.h"
 
 int main()
 {
@@ -34,6 +35,16 @@ int main()
            t, 					// hopping amplitude
            grid.get_N(), result.omega, result.NIDOS);	// total number of omega grid points, omega-grid array, the array in which NIDOS will be stored
 
+  // optionally use the DOS of a tight-binding lattice (dispersion set by TB:: params) for both NIDOS and the initial Delta
+  bool UseTightBinding = false;
+  input.ReadParam(UseTightBinding,"main::UseTightBinding");
+  if (UseTightBinding)
+  { TightBinding tb("params");
+    tb.get_DOS(grid.get_N(), result.omega, result.NIDOS);
+    tb.get_G(grid.get_N(), result.omega, result.NIDOS, result.Delta);
+    for (int i=0; i<grid.get_N(); i++) result.Delta[i] *= 0.25;	// hybridization-V = 0.5 as above
+  }
+
   // read the occupation number and put it in result to be used as input for CHM
   double n = 0.5; // always set a default value in case parameter is not found in the input file!!!
   input.ReadParam(n,"main::n");
@@ -48,7 +59,17 @@ int main()
   // now print the result to a file named accordingly to the parameters of the calculation
   char FN[50];
   sprintf( FN, "CHM.U%.3f.T%.3f", chm.get_U(), chm.get_T() );
+  result.Header = input.Serialize();
   result.PrintResult(FN);
 
+  // optionally export G, Sigma and Delta on the first NMatsubara Matsubara frequencies
+  int NMatsubara = 0;
+  input.ReadParam(NMatsubara,"main::NMatsubara");
+  if (NMatsubara > 0)
+  { char MFN[60];
+    sprintf( MFN, "MATS.%s", FN );
+    chm.PrintOnImagAxis(&result, MFN, NMatsubara);
+  }
+
   return 0;
 }
@@ -3,6 +3,7 @@
 #include "../source/Result.h"
 #include "../source/routines.h"
 #include "../source/Input.h"
+#include "../source/ResultCache.h"
 
 void PrintReport(const char* ReportFN, double U, double T, const char* message)
 {
@@ -11,6 +12,14 @@ void PrintReport(const char* ReportFN, double U, double T, const char* message)
   fclose(ReportFile);  
 }
 
+void SeedDelta(ResultCache* cache, double U, double T, Result* result)
+{ // start a branch from the nearest cached point, if there is one
+  double coords[2] = { U, T };
+  Result nearest(result->grid);
+  if (cache->LoadNearest(2, coords, &nearest))
+    for (int i=0; i<result->grid->get_N(); i++) result->Delta[i] = nearest.Delta[i];
+}
+
 int main()
 {
   double Ustart = 2.5;
@@ -26,6 +35,10 @@ int main()
   input.ReadParam(Tstart, "main::Tstart");
   input.ReadParam(Tend, "main::Tend");
   input.ReadParam(Tstep, "main::Tstep");
+  input.ReadParam(Ustart, "main::Ustart");
+  input.ReadParam(Uend, "main::Uend");
+  input.ReadParam(Ustep_max, "main::Ustep_max");
+  input.ReadParam(Ustep_min, "main::Ustep_min");
   GRID grid("params");
   
   Result result(&grid);
@@ -43,9 +56,23 @@ int main()
   input.ReadParam(n,"main::n");
   result.n = n; 
 
+  int NMatsubara = 0;	// Matsubara data of every point is exported if > 0
+  input.ReadParam(NMatsubara,"main::NMatsubara");
+
   CHM chm("params");
   double Ustep;
 
+  // converged points are cached by (U,T), params, grid and the branch of the hysteresis.
+  // the sweep and its output do not enter, so a wider or finer sweep reuses the cache
+  const char* Swept[] = { "CHM::U", "CHM::T", "main::Tstart", "main::Tend", "main::Tstep",
+                          "main::Ustart", "main::Uend", "main::Ustep_max", "main::Ustep_min", "main::NMatsubara" };
+  ResultCache FromMet("cache");
+  ResultCache FromIns("cache");
+  FromMet.SetNumerics(&grid, input.Serialize() + "FromMet branch\n", 10, Swept);
+  FromIns.SetNumerics(&grid, input.Serialize() + "FromIns branch\n", 10, Swept);
+
+  Result resCopy(&grid);	//arrays are reused for every point
+
   for (double T=Tstart; T<Tend; T+=Tstep)
   { 
     InitDelta( DOStypes::SemiCircle,	
@@ -61,28 +88,34 @@ int main()
 
     double Ustep = Ustep_max; 
     double U = Ustart;
+    SeedDelta(&FromMet, U, T, &result);
     
     bool ReachedEnd = false;
     do 
     { 
       chm.SetParams(U,T,t);
       
-      Result resCopy(result);
+      resCopy.CopyFrom(result);
 
       char FN[50];
       sprintf( FN, "CHM.%s.T%.3f.U%.3f", (Ustep>0.0) ? "FromMet" : "FromIns", T, U );
 
-      FILE* f = fopen(FN,"r");
-      if (f!=NULL) 
-        result.ReadFromFile(FN);
-      else
+      ResultCache* cache = (Ustep>0.0) ? &FromMet : &FromIns;
+      double coords[2] = { U, T };
+      if (!cache->Load(2, coords, &result))
       {  
          PrintReport("report",  U,  T, "Working..."); 
-         chm.Run(&result);
-         PrintReport("report",  U,  T, "Done!"); 
+         bool Failed = chm.Run(&result);	//true if not converged
+         PrintReport("report",  U,  T, (Failed) ? "Not converged!" : "Done!"); 
+         if (!Failed) cache->Store(2, coords, &result);
       }
       
       result.PrintResult(FN);
+      if (NMatsubara > 0)
+      { char MFN[60];
+        sprintf( MFN, "MATS.%s", FN );
+        chm.PrintOnImagAxis(&result, MFN, NMatsubara);
+      }
   
       if ( ( (Ustep > 0.0) and (LastDOS0 / result.DOS[grid.get_N()/2] > 3.0) )
          )
@@ -105,6 +138,7 @@ int main()
               InitDOS( DOStypes::SemiCircle, 		
                        t, 					
                        grid.get_N(), result.omega, result.DOS);
+              SeedDelta(&FromIns, Uend, T, &result);
            }
            
       }
@@ -1,6 +1,7 @@
 #include "../source/Result.h"
 #include "../source/GRID.h"
 #include "../source/routines.h"
+#include "../source/HistoryArchive.h"
 
 int main()
 {
@@ -31,6 +32,23 @@ int main()
   r3.ReadFromFile("Result.dat.c");
   r3.n = 0.3;  
   r3.PrintResult("Result.dat.cc");  
+
+  // binary files are read back exactly, including mu, n and mu0
+  r2.PrintResult("Result.bin", ResultFormats::Binary);
+  Result r4(&grid);
+  r4.ReadFromFile("Result.bin");
+  r4.PrintResult("Result.bin.txt");
+
+  // history of iterations: append results, then read any of them back
+  HistoryArchive archive;
+  archive.Create("history", grid.get_N(), 32);
+  archive.Append(1, &result);
+  archive.Append(2, &r2);
+  archive.Close();
+  Result r5(&grid);
+  archive.Open("history");
+  archive.Read(2, &r5);
+  r5.PrintResult("history.2.dat");
   
   return 0;
 }
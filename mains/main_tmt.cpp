@@ -93,6 +93,8 @@ int main(int argc, char* argv[])
             char FN[50];
             sprintf(FN, "TMT.U%.3f.T%.3f.W%.3f%s", tmt.get_U(), tmt.get_T(), tmt.get_W(), 
                                                    (failed) ? ".FAILED" : "" );
+	    Input input("params");
+	    result.Header = input.Serialize();
 	    result.PrintResult(FN);
 
 
@@ -0,0 +1,109 @@
+#include "AsyncWriter.h"
+#include "Result.h"
+#include "GRID.h"
+
+AsyncWriter::AsyncWriter()
+{
+  Async = true;
+  QueueDepth = 4;
+  Nsnapshots = 0;
+  Busy = 0;
+  Started = false;
+  Stop = false;
+}
+
+AsyncWriter::~AsyncWriter()
+{
+  Flush();
+  if (Started)
+  { { lock_guard<mutex> lock(m);
+      Stop = true;
+    }
+    JobReady.notify_all();
+    worker.join();
+  }
+  for (size_t i=0; i<pool.size(); i++) delete pool[i];
+}
+
+void AsyncWriter::SetOptions(bool Async, int QueueDepth)
+{
+  Flush();
+  this->Async = Async;
+  this->QueueDepth = (QueueDepth < 1) ? 1 : QueueDepth;
+}
+
+void AsyncWriter::Snapshot(Result* to, Result* from)
+{
+  to->CopyFrom(*from);
+}
+
+void AsyncWriter::Write(Result* r, const char* ResultFN)
+{
+  Write(r, ResultFN, ResultFormats::Text);
+}
+
+void AsyncWriter::Write(Result* r, const char* ResultFN, int Format)
+{
+  if (!Async)
+  { r->PrintResult(ResultFN, Format);
+    return;
+  }
+
+  Result* s;
+  { unique_lock<mutex> lock(m);
+    if (!Started)
+    { worker = thread(&AsyncWriter::Work, this);
+      Started = true;
+    }
+    //one snapshot per queue slot plus the one being written
+    while ( (queue.size() >= (size_t) QueueDepth) or ( pool.empty() and (Nsnapshots > QueueDepth) ) )
+      JobDone.wait(lock);
+    if (pool.empty())
+    { s = new Result(r->grid);
+      Nsnapshots++;
+    }
+    else
+    { s = pool.back();
+      pool.pop_back();
+    }
+  }
+
+  Snapshot(s, r);
+
+  { lock_guard<mutex> lock(m);
+    Job job;
+    job.r = s;
+    job.FN.assign(ResultFN);
+    job.Format = Format;
+    queue.push_back(job);
+  }
+  JobReady.notify_one();
+}
+
+void AsyncWriter::Work()
+{
+  while (true)
+  { Job job;
+    { unique_lock<mutex> lock(m);
+      while ( queue.empty() and (!Stop) ) JobReady.wait(lock);
+      if (queue.empty()) return;
+      job = queue.front();
+      queue.pop_front();
+      Busy++;
+    }
+
+    job.r->PrintResult(job.FN.c_str(), job.Format);
+
+    { lock_guard<mutex> lock(m);
+      pool.push_back(job.r);
+      Busy--;
+    }
+    JobDone.notify_all();
+  }
+}
+
+void AsyncWriter::Flush()
+{
+  unique_lock<mutex> lock(m);
+  while ( (!queue.empty()) or (Busy > 0) ) JobDone.wait(lock);
+}
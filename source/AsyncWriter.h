@@ -0,0 +1,56 @@
+//*************************************************//
+//    Background writer for Result dumps           //
+//*************************************************//
+
+// Write() snapshots the arrays of a Result into a pooled buffer and returns; the
+// snapshot is formatted and written to disk on a background thread. At most
+// QueueDepth dumps wait in the queue, Write() blocks when the queue is full.
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+
+using namespace std;
+
+class Result;
+
+class AsyncWriter
+{
+  private:
+    struct Job
+    { Result* r;
+      string FN;
+      int Format;
+    };
+
+    bool Async;			//if false, Write() writes directly
+    int QueueDepth;
+
+    deque<Job> queue;
+    vector<Result*> pool;	//free snapshots
+    int Nsnapshots;		//snapshots allocated
+    int Busy;			//jobs being written
+
+    mutex m;
+    condition_variable JobReady;
+    condition_variable JobDone;
+    thread worker;
+    bool Started;
+    bool Stop;
+
+    void Work();
+    void Snapshot(Result* to, Result* from);
+
+  public:
+    AsyncWriter();
+    ~AsyncWriter();
+
+    void SetOptions(bool Async, int QueueDepth);
+
+    void Write(Result* r, const char* ResultFN);		//text format
+    void Write(Result* r, const char* ResultFN, int Format);	//see ResultFormats
+    void Flush();		//waits until all queued dumps are on disk
+};
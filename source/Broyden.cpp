@@ -79,6 +79,7 @@ int Broyden::CalculateNew(complex<double> Vnew[], int it)
   it -= LastReset;
 
   if (!Initialized) { printf("ERROR: Broyden not initialized!\n"); exit(1); }
+  if (it > Nrows) Nrows = it;
 
   for (int i=0; i<N; i++)
   {
@@ -122,9 +123,67 @@ int Broyden::CalculateNew(complex<double> Vnew[], int it)
 
 
 
+//---- checkpointing ----//
+void Broyden::Save(FILE* f)
+{
+  fwrite(&Initialized, sizeof(bool), 1, f);
+  fwrite(&N, sizeof(int), 1, f);
+  fwrite(&LastReset, sizeof(int), 1, f);
+  fwrite(&CurrentDiff, sizeof(double), 1, f);
+  if (!Initialized) return;
+
+  fwrite(&Nrows, sizeof(int), 1, f);
+  fwrite(V, sizeof(complex<double>), N, f);
+  fwrite(Vold, sizeof(complex<double>), N, f);
+  fwrite(F, sizeof(complex<double>), N, f);
+  fwrite(Fold, sizeof(complex<double>), N, f);
+  fwrite(c, sizeof(complex<double>), Nrows, f);
+  for (int it=0; it<Nrows; it++)
+  { fwrite(A[it], sizeof(complex<double>), Nrows, f);
+    fwrite(Beta[it], sizeof(complex<double>), Nrows, f);
+    fwrite(DV[it], sizeof(complex<double>), N, f);
+    fwrite(DF[it], sizeof(complex<double>), N, f);
+    fwrite(U[it], sizeof(complex<double>), N, f);
+  }
+}
+
+bool Broyden::Load(FILE* f)
+{
+  bool On;
+  int N;
+  bool ok = (fread(&On, sizeof(bool), 1, f) == 1)
+            and (fread(&N, sizeof(int), 1, f) == 1);
+  if ( (!ok) or (N != this->N) ) 
+  { printf("ERROR: Broyden: saved state does not match!\n");
+    return false;
+  }
+  if (Initialized) ReleaseMemory();
+  Initialized = false;
+  ok = (fread(&LastReset, sizeof(int), 1, f) == 1)
+       and (fread(&CurrentDiff, sizeof(double), 1, f) == 1);
+  if ( (!ok) or (!On) ) return ok;
+
+  PrepareArrays();
+  Initialized = true;
+  ok = (fread(&Nrows, sizeof(int), 1, f) == 1) and (Nrows <= MAX_ITS)
+       and (fread(V, sizeof(complex<double>), N, f) == (size_t) N)
+       and (fread(Vold, sizeof(complex<double>), N, f) == (size_t) N)
+       and (fread(F, sizeof(complex<double>), N, f) == (size_t) N)
+       and (fread(Fold, sizeof(complex<double>), N, f) == (size_t) N)
+       and (fread(c, sizeof(complex<double>), Nrows, f) == (size_t) Nrows);
+  for (int it=0; (ok) and (it<Nrows); it++)
+    ok = (fread(A[it], sizeof(complex<double>), Nrows, f) == (size_t) Nrows)
+         and (fread(Beta[it], sizeof(complex<double>), Nrows, f) == (size_t) Nrows)
+         and (fread(DV[it], sizeof(complex<double>), N, f) == (size_t) N)
+         and (fread(DF[it], sizeof(complex<double>), N, f) == (size_t) N)
+         and (fread(U[it], sizeof(complex<double>), N, f) == (size_t) N);
+  return ok;
+}
+
 //----allocates arrays----//
 void Broyden::PrepareArrays()
 {
+  Nrows = 0;
   V = new complex<double> [N];
   Vold = new complex<double> [N];
   F = new complex<double> [N];
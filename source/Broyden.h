@@ -28,6 +28,7 @@ class Broyden
 
     //--LastReset--//
     int LastReset;
+    int Nrows;			//rows of the storage arrays in use since LastReset
     //--storage arrays--//
     complex<double>* c;		//MAX_ITS x 1
     complex<double>** U;		//MAX_ITS x N
@@ -65,6 +66,10 @@ class Broyden
     void Reset(int it);
     int CalculateNew(complex<double> Vnew[], int it);
     double CurrentDiff;
+
+    //--checkpointing (only the rows in use are saved)--//
+    void Save(FILE* f);
+    bool Load(FILE* f);		//SetParameters with the saved N must be called first, MAX_ITS may grow
 };
 
 
@@ -4,6 +4,11 @@
 #include "Input.h"
 #include "SIAM.h"
 #include "routines.h"
+#include "ExecutionContext.h"
+#include "AsyncWriter.h"
+#include "LatticeTable.h"
+#include "MatsubaraTransform.h"
+#include "TextWriter.h"
 #include <omp.h>
 
 class SIAM;
@@ -16,7 +21,10 @@ void CHM::Defaults()
     SIAMeta = 1e-5;
     t = 0.5;
     SiamNt = 8;
+    PrintDelta = true;
     siam = new SIAM();
+    exec = new ExecutionContext();
+    exec->SetTeamSize(Phases::Siam, SiamNt);
 
     SIAMUseLatticeSpecificG = false;
     LatticeType = DOStypes::SemiCircle;
@@ -43,8 +51,15 @@ CHM::CHM(const char* ParamsFN) : Loop(ParamsFN)
 
   input.ReadParam(SIAMUseLatticeSpecificG,"CHM::SIAMUseLatticeSpecificG");
   input.ReadParam(LatticeType,"CHM::LatticeType");
+  string LatticeTableDir;
+  if (input.ReadParam(LatticeTableDir,"CHM::LatticeTableDir") == 0) LatticeTable::SetDir(LatticeTableDir.c_str());
 
   input.ReadParam(SiamNt,"CHM::SiamNt"); 
+  input.ReadParam(PrintDelta,"CHM::PrintDelta");
+
+  delete exec;
+  exec = new ExecutionContext(ParamsFN);
+  exec->SetTeamSize(Phases::Siam, SiamNt);
 
   siam = new SIAM(ParamsFN);
 }
@@ -53,6 +68,7 @@ void CHM::ReleaseMemory()
 {
   printf("CHM release\n");
   siam->~SIAM();
+  delete exec;
 }
 
 CHM::~CHM()
@@ -60,6 +76,12 @@ CHM::~CHM()
   ReleaseMemory();
 }
 
+unsigned long long CHM::get_RunHash()
+{
+  double p[4] = { U, T, t, r->n };
+  return Hash(p, sizeof(p), Loop::get_RunHash());
+}
+
 void CHM::SetParams(double U, double T, double t)
 {
   this->U = U;
@@ -77,6 +99,37 @@ void CHM::SetSIAMeta(double SIAMeta)
   this->SIAMeta = SIAMeta;
 }
 
+void CHM::SetPrintDelta(bool PrintDelta)
+{
+  this->PrintDelta = PrintDelta;
+}
+
+void CHM::PrintOnImagAxis(Result* r, const char* FN, int M)
+{
+  complex<double>* G = new complex<double>[3*M];
+  siam->SetUTepsilon(U,T,0.0);
+  siam->GetOnImagAxis(r, M, G, G+M, G+2*M);
+  MatsubaraTransform* mt = siam->get_MatsubaraTransform();
+
+  TextWriter f(FN);
+  if (!f.IsOpen()) { printf("-- ERROR -- CHM: could not open %s\n", FN); delete [] G; return; }
+  char header[100];
+  snprintf(header, 100, "# U = %.6f T = %.6f n (Matsubara sum with tail) = ", U, T);
+  f.Put(header);
+  f.Put(mt->MatsubaraSum(0, M, G));
+  f.Put('\n');
+  //nu, G, Sigma, Delta
+  for (int m=0; m<M; m++)
+  { f.Put(MatsubaraTransform::Frequency(T, m));
+    for (int k=0; k<3; k++)
+    { f.Put(' '); f.Put(real(G[k*M+m]));
+      f.Put(' '); f.Put(imag(G[k*M+m]));
+    }
+    f.Put('\n');
+  }
+  delete [] G;
+}
+
 void CHM::SetSIAMUseLatticeSpecificG(bool SIAMUseLatticeSpecificG)
 {
   this->SIAMUseLatticeSpecificG = SIAMUseLatticeSpecificG;
@@ -89,15 +142,14 @@ bool CHM::SolveSIAM()
   siam->SetIsBethe(UseBethe);
   siam->SetBroadening(SIAMeta);
   siam->SetUseLatticeSpecificG(SIAMUseLatticeSpecificG, t, LatticeType); 
-#ifdef _OMP
-  omp_set_num_threads(SiamNt);
-#endif
+  ThreadTeam team(exec, Phases::Siam);
+  siam->SetNt(team.get_Nt());
   return siam->Run_CHM(r);
 }
 
 void CHM::CalcDelta()
 {
-  r->PrintResult("CHMDeltaIN");
+  if (PrintDelta) writer->Write(r, "CHMDeltaIN");
   
   if (UseBethe) printf("\n\n-- INFO -- CHM Self Consistency - Delta = t^G, t=%f\n\n",t);
   if (UseBethe)
@@ -109,6 +161,6 @@ void CHM::CalcDelta()
     for (int i=0; i<N; i++) 
       r->Delta[i] = r->omega[i] + r->mu - r->Sigma[i] - 1.0/r->G[i];
 
-  r->PrintResult("CHMDeltaOUT");
+  if (PrintDelta) writer->Write(r, "CHMDeltaOUT");
   
 }
@@ -3,6 +3,7 @@
 using namespace std;
 
 class SIAM;
+class ExecutionContext;
 
 class CHM: public Loop
 {
@@ -18,7 +19,9 @@ class CHM: public Loop
     SIAM* siam;
     double SIAMeta;
     bool UseBethe;
+    bool PrintDelta;		//dump CHMDeltaIN and CHMDeltaOUT on every iteration
     int SiamNt;
+    ExecutionContext* exec;	//thread teams of parallel phases
 
     bool SIAMUseLatticeSpecificG;
     int LatticeType;
@@ -27,6 +30,7 @@ class CHM: public Loop
     virtual void CalcDelta();  
    
     virtual void ReleaseMemory();
+    virtual unsigned long long get_RunHash();	//also U, T and t, which sweeps set with SetParams
 
   public:
     CHM();
@@ -38,6 +42,9 @@ class CHM: public Loop
 
     void SetUseBethe(bool UseBethe);
     void SetSIAMeta(double eta);
+    void SetPrintDelta(bool PrintDelta);
+
+    void PrintOnImagAxis(Result* r, const char* FN, int M);	//G, Sigma and Delta at the first M Matsubara frequencies
 
     double get_U() { return U; };
     double get_T() { return T; };
@@ -0,0 +1,154 @@
+#include <cstdio>
+#include "ExecutionContext.h"
+#include "Input.h"
+#include "Result.h"
+
+#ifdef _MPI
+#include "mpi.h"
+#endif
+
+#ifdef _OMP
+#include <omp.h>
+#endif
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+void ExecutionContext::Defaults()
+{
+  for (int i=0; i<Phases::Nphases; i++) TeamSize[i] = 0;
+  Affinity = AffinityPolicies::None;
+  FirstCore = 0;
+  NCores = 0;
+  RanksPerNode = 1;
+  LocalRank = 0;
+  FirstTouch = Result::FirstTouch;
+}
+
+ExecutionContext::ExecutionContext()
+{
+  Defaults();
+}
+
+ExecutionContext::ExecutionContext(const char* ParamsFN)
+{
+  Defaults();
+
+  Input input(ParamsFN);
+
+  input.ReadParam(Affinity,"Exec::Affinity");
+  input.ReadParam(FirstCore,"Exec::FirstCore");
+  input.ReadParam(NCores,"Exec::NCores");
+  input.ReadParam(RanksPerNode,"Exec::RanksPerNode");
+
+  SetAffinity(Affinity, FirstCore, NCores, RanksPerNode);
+  input.ReadParam(FirstTouch,"Exec::FirstTouch");
+  SetFirstTouch(FirstTouch);
+}
+
+void ExecutionContext::SetFirstTouch(int FirstTouch)
+{
+  this->FirstTouch = FirstTouch;
+  Result::FirstTouch = FirstTouch;
+}
+
+void ExecutionContext::SetTeamSize(int Phase, int Nt)
+{
+  TeamSize[Phase] = Nt;
+}
+
+int ExecutionContext::get_TeamSize(int Phase)
+{
+#ifdef _OMP
+  return (TeamSize[Phase] > 0) ? TeamSize[Phase] : omp_get_max_threads();
+#else
+  return 1;
+#endif
+}
+
+void ExecutionContext::SetAffinity(int Affinity, int FirstCore, int NCores, int RanksPerNode)
+{
+  this->Affinity = Affinity;
+  this->FirstCore = FirstCore;
+  this->RanksPerNode = (RanksPerNode < 1) ? 1 : RanksPerNode;
+#ifdef __linux__
+  this->NCores = (NCores > 0) ? NCores : sysconf(_SC_NPROCESSORS_ONLN) - FirstCore;
+#else
+  this->NCores = (NCores > 0) ? NCores : 1;
+#endif
+  if (this->NCores < 1) this->NCores = 1;
+
+  LocalRank = 0;
+#ifdef _MPI
+  int Initialized;
+  MPI_Initialized(&Initialized);
+  if (Initialized)
+  { int myrank;
+    MPI_Comm_rank(MPI_COMM_WORLD, &myrank);
+    LocalRank = myrank % this->RanksPerNode;
+  }
+#endif
+
+  if (Affinity != AffinityPolicies::None)
+    printf("-- INFO -- Exec: %s affinity on cores %d to %d, %d processes per node, %d cores each\n",
+           (Affinity == AffinityPolicies::Compact) ? "compact" : "spread",
+           this->FirstCore, this->FirstCore + this->NCores - 1, this->RanksPerNode,
+           (this->NCores / this->RanksPerNode > 0) ? this->NCores / this->RanksPerNode : 1);
+}
+
+int ExecutionContext::Core(int tid, int Nt)
+{
+  if (Affinity == AffinityPolicies::None) return -1;
+
+  //the block of the process does not depend on the team size of the phase
+  int Block = NCores / RanksPerNode;
+  if (Block < 1) Block = 1;
+  int First = LocalRank * Block;
+
+  if (Affinity == AffinityPolicies::Compact)
+    return FirstCore + (First + tid % Block) % NCores;
+  else
+  { //threads strided over the block
+    int stride = Block / Nt;
+    if (stride < 1) stride = 1;
+    return FirstCore + (First + (tid * stride) % Block) % NCores;
+  }
+}
+
+//-------------------- ThreadTeam ------------------------//
+
+ThreadTeam::ThreadTeam(ExecutionContext* exec, int Phase)
+{
+  Nt = exec->get_TeamSize(Phase);
+#ifdef __linux__
+  OldMask = NULL;
+#endif
+#if defined(_OMP) && defined(__linux__)
+  if (exec->Core(0, Nt) < 0) return;
+  OldMask = new cpu_set_t[Nt];
+  #pragma omp parallel num_threads(Nt)
+  { 
+    int tid = omp_get_thread_num();
+    sched_getaffinity(0, sizeof(cpu_set_t), &OldMask[tid]);
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(exec->Core(tid, Nt), &set);
+    sched_setaffinity(0, sizeof(cpu_set_t), &set);
+  }
+#endif
+}
+
+ThreadTeam::~ThreadTeam()
+{
+#if defined(_OMP) && defined(__linux__)
+  if (OldMask != NULL)
+  { 
+    #pragma omp parallel num_threads(Nt)
+    sched_setaffinity(0, sizeof(cpu_set_t), &OldMask[omp_get_thread_num()]);
+  }
+#endif
+#ifdef __linux__
+  delete [] OldMask;
+#endif
+}
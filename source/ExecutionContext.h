@@ -0,0 +1,71 @@
+//*************************************************//
+//    Thread teams and core pinning per phase      //
+//*************************************************//
+
+// Every parallel phase (averaging, impurity solver, Kramars-Kronig) gets its own
+// team size, which the phase passes to its parallel regions with num_threads. A
+// ThreadTeam pins the threads of its phase for its scope and gives them back their
+// previous affinity when it goes out of scope, so phases do not inherit each other's
+// settings. Each process owns a fixed block of NCores/RanksPerNode cores, the team of
+// every phase is placed inside it.
+
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Phases
+{
+  const int Average = 0;
+  const int Siam = 1;
+  const int KramarsKronig = 2;
+  const int Nphases = 3;
+}
+
+namespace AffinityPolicies
+{
+  const int None = 0;		//threads are left to the OS
+  const int Compact = 1;	//threads on neighbouring cores of the block of the process
+  const int Spread = 2;		//threads spread over the block of the process
+}
+
+class ExecutionContext
+{
+  private:
+    void Defaults();
+
+    int TeamSize[Phases::Nphases];	//0 means runtime default
+
+    int Affinity;
+    int FirstCore;		//first core available to the job
+    int NCores;			//number of cores available to the job on a node, 0 for all online cores
+    int RanksPerNode;		//MPI processes sharing a node
+    int LocalRank;		//index of this process on its node
+
+    int FirstTouch;		//FirstTouchPolicies (Result.h) for newly allocated Results
+
+  public:
+    ExecutionContext();
+    ExecutionContext(const char* ParamsFN);
+
+    void SetTeamSize(int Phase, int Nt);
+    int get_TeamSize(int Phase);
+    void SetAffinity(int Affinity, int FirstCore, int NCores, int RanksPerNode);
+    void SetFirstTouch(int FirstTouch);
+
+    //core of thread tid of a team of Nt threads according to Affinity, -1 if not pinned
+    int Core(int tid, int Nt);
+};
+
+class ThreadTeam
+{
+  private:
+    int Nt;
+#ifdef __linux__
+    cpu_set_t* OldMask;		//affinity of each thread before the team was pinned, NULL if not pinned
+#endif
+  public:
+    ThreadTeam(ExecutionContext* exec, int Phase);
+    ~ThreadTeam();
+
+    int get_Nt() { return Nt; };
+};
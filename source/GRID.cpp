@@ -5,6 +5,17 @@
 
 //==================== Constructors destruictors ==================//
 
+void GRID::Init()
+{
+  omega = NULL;
+  weights = NULL;
+  Nweights = 0;
+  KKsums = NULL;
+  NKKsums = 0;
+  QuadratureOrder = 2;
+  InterpolationOrder = 2;
+}
+
 void GRID::Defaults()
 {
   GridType = GridTypes::LogLin;
@@ -18,11 +29,13 @@ void GRID::Defaults()
 
 GRID::GRID()
 {
+  Init();
   Defaults();
 }
 
 GRID::GRID(int N, double omega_lin_max, bool OnlyPositive)
 {
+  Init();
   if (!OnlyPositive)
     GridType = GridTypes::Linear;
   else 
@@ -34,6 +47,7 @@ GRID::GRID(int N, double omega_lin_max, bool OnlyPositive)
 
 GRID::GRID(int Nlog, int Nlin, double omega_lin_max, double omega_max, double omega_min)
 {
+  Init();
   GridType = GridTypes::LogLin;
   this->Nlog = Nlog;
   this->Nlin = Nlin;
@@ -45,6 +59,7 @@ GRID::GRID(int Nlog, int Nlin, double omega_lin_max, double omega_max, double om
 
 GRID::GRID(double domega_min, double domega_max, double omega_max, double omega_lin_max)
 {
+  Init();
   GridType = GridTypes::Jaksa;
   this->omega_min = domega_min;
   this->omega_lin_max = omega_lin_max;
@@ -55,6 +70,7 @@ GRID::GRID(double domega_min, double domega_max, double omega_max, double omega_
 
 GRID::GRID(const char* ParamsFN)
 {
+  Init();
   Defaults();
 
   Input input(ParamsFN);
@@ -87,11 +103,14 @@ GRID::GRID(const char* ParamsFN)
       // TODO
     } break;
   }
+  input.ReadParam(QuadratureOrder,"GRID::QuadratureOrder");
+  input.ReadParam(InterpolationOrder,"GRID::InterpolationOrder");
 }
 
 GRID::~GRID()
 {
-
+  delete [] weights;
+  delete [] KKsums;
 }
 //======================= Initializers =============================//
 double GRID::get_omega(int i)
@@ -160,11 +179,129 @@ void GRID::assign_omega(double* omega)
       for (int i=0; i<N; i++) omega[i] = domega * (i + 0.5) ;
     } break;
   }
+
+  //the omega values are the same on every call, results may be created in parallel
+  if (Nweights.load(memory_order_acquire) != N)
+  {
+    #pragma omp critical(GRIDweights)
+    if (Nweights.load(memory_order_relaxed) != N)
+    { double* w = new double[N];
+      get_Weights(w);
+      delete [] weights;
+      weights = w;
+      Nweights.store(N, memory_order_release);
+    }
+  }
+}
+
+void GRID::SetQuadratureOrder(int QuadratureOrder)
+{
+  this->QuadratureOrder = QuadratureOrder;
+  Nweights = 0;
+  NKKsums = 0;
+}
+
+void GRID::SetInterpolationOrder(int InterpolationOrder)
+{
+  this->InterpolationOrder = InterpolationOrder;
+}
+
+int GRID::get_Segments(int* bounds, bool* logarithmic)
+{ //segment s spans indices bounds[s]..bounds[s+1]: lin, log, the gap around 0, log, lin
+  if ( (GridType == GridTypes::Linear) and (N > 2) )
+  { bounds[0] = 0;
+    bounds[1] = N-1;
+    logarithmic[0] = false;
+    return 1;
+  }
+  if ( (GridType != GridTypes::LogLin) or (Nlog < 4) or (Nlin < 2) ) return 0;
+  int b[6] = { 0, Nlin/2, N/2-1, N/2, Nlin/2+Nlog-1, N-1 };
+  bool l[5] = { false, true, false, true, false };
+  for (int s=0; s<6; s++) bounds[s] = b[s];
+  for (int s=0; s<5; s++) logarithmic[s] = l[s];
+  return 5;
+}
+
+void GRID::get_Weights(double* w)
+{ //Simpson on each segment, in log|omega| on the logarithmic ones. Segments with an odd
+  //number of intervals end with the 3/8 rule, single intervals are trapezoids
+  int bounds[6];
+  bool logarithmic[5];
+  int Nsegments = (QuadratureOrder >= 4) ? get_Segments(bounds, logarithmic) : 0;
+  if (Nsegments == 0)
+  { TrapezWeights(N, omega, w);
+    return;
+  }
+
+  for (int i=0; i<N; i++) w[i] = 0.0;
+  for (int s=0; s<Nsegments; s++)
+  { int lo = bounds[s], n = bounds[s+1] - bounds[s];
+    double h = (logarithmic[s]) ? log( abs(omega[lo+n]) / abs(omega[lo]) ) / n
+                                : (omega[lo+n] - omega[lo]) / n;
+    double* c = new double[n+1];
+    for (int j=0; j<=n; j++) c[j] = 0.0;
+    if (n == 1) c[0] = c[1] = 0.5;
+    else
+    { int nS = (n % 2 == 0) ? n : n-3;	//intervals done by Simpson
+      for (int j=0; j<nS; j+=2)
+      { c[j] += 1.0/3.0;
+        c[j+1] += 4.0/3.0;
+        c[j+2] += 1.0/3.0;
+      }
+      if (nS < n)
+      { c[nS] += 3.0/8.0;
+        c[nS+1] += 9.0/8.0;
+        c[nS+2] += 9.0/8.0;
+        c[nS+3] += 3.0/8.0;
+      }
+    }
+    //d omega = omega d log|omega|, with h < 0 on the negative side
+    for (int j=0; j<=n; j++)
+      w[lo+j] += c[j] * h * ( (logarithmic[s]) ? omega[lo+j] : 1.0 );
+    delete [] c;
+  }
+}
+
+double GRID::Cubic(double X[], int k, double om)
+{ //Lagrange through 4 points of the segment holding [k,k+1], in log|omega| on log segments
+  int bounds[6];
+  bool logarithmic[5];
+  int Nsegments = get_Segments(bounds, logarithmic);
+  int s = 0;
+  while ( (s < Nsegments-1) and (k >= bounds[s+1]) ) s++;
+  if ( (Nsegments == 0) or (bounds[s+1] - bounds[s] < 3) )
+    return X[k] + (X[k+1]-X[k]) * (om - omega[k]) / (omega[k+1] - omega[k]);
+  int lo = bounds[s], hi = bounds[s+1];
+
+  int j0 = k - 1;
+  if (j0 < lo) j0 = lo;
+  if (j0 > hi-3) j0 = hi-3;
+  double v[4];
+  for (int j=0; j<4; j++) v[j] = (logarithmic[s]) ? log(abs(omega[j0+j])) : omega[j0+j];
+  double x = (logarithmic[s]) ? log(abs(om)) : om;
+  double sum = 0.0;
+  for (int j=0; j<4; j++)
+  { double l = 1.0;
+    for (int m=0; m<4; m++)
+      if (m != j) l *= (x - v[m]) / (v[j] - v[m]);
+    sum += l * X[j0+j];
+  }
+  return sum;
 }
 
 //================================ routines ===============================//
 
-void GRID::KramarsKronig(complex<double> Y[])
+double GRID::Integrate(const double* Y)
+{
+  return WeightedSum(N, weights, Y);
+}
+
+complex<double> GRID::Integrate(const complex<double>* Y)
+{
+  return WeightedSum(N, weights, Y);
+}
+
+void GRID::KramarsKronig(complex<double> Y[], int Nt)
 {
  
   if (omega == NULL) 
@@ -173,36 +310,59 @@ void GRID::KramarsKronig(complex<double> Y[])
     return;
   }
 
-  //int k;
+  //C_i = sum_{j!=i} w_j / (omega_i - omega_j) depends on the grid only
+  if (NKKsums.load(memory_order_acquire) != N)
+  {
+    #pragma omp critical(GRIDweights)
+    if (NKKsums.load(memory_order_relaxed) != N)
+    { double* C = new double[N];
+      #pragma omp parallel for num_threads(Nt)
+      for (int i=0; i<N; i++)
+      { double sum = 0;
+        for (int j=0; j<N; j++)
+          if (j != i) sum += weights[j] / (omega[i] - omega[j]);
+        C[i] = sum;
+      }
+      delete [] KKsums;
+      KKsums = C;
+      NKKsums.store(N, memory_order_release);
+    }
+  }
 
-  double** s = new double*[N];  
-  #pragma omp parallel for
+  //runs of points where Im Y is nonzero, only those enter the sums over j.
+  //sum_j w_j (Im Y_j - y) / (omega_i - omega_j) = sum_{j in runs} w_j Im Y_j / (omega_i - omega_j) - y C_i
+  double* y = new double[N];
+  vector<int> runs;
+  for (int j=0; j<N; j++)
+  { y[j] = imag(Y[j]);
+    if (y[j] != 0.0)
+    { if ( (runs.size() == 0) or (runs.back() != j) ) { runs.push_back(j); runs.push_back(j+1); }
+      else runs.back() = j+1;
+    }
+  }
+  int Nruns = runs.size() / 2;
+
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++)
   { 
-
-    double y = imag(Y[i]);
     double LogTerm = ( (i==0) || (i==N-1) ) 
                     ? 0.0
-                    : y * log( (omega_lin_max-omega[i])
+                    : y[i] * log( (omega_lin_max-omega[i])
                               /(omega[i]+omega_lin_max) );
 
-    s[i] = new double[N];
-    for (int j=0; j<N; j++)
-    { 
-      if (i==j)
-        s[i][j] =  imag(   Y[ j + ( (j < N-1) ? 1 : 0 ) ]
-                      - Y[ j - ( (j > 0)   ? 1 : 0 ) ] )   
-               / (  omega[ j + ( (j < N-1) ? 1 : 0 ) ]
-                  - omega[ j - ( (j > 0)   ? 1 : 0 ) ] );
-      else
-        s[i][j] = ( imag(Y[j]) - y) 
-               / ( omega[i]-omega[j] );
-    }                     
-    Y[i] = complex<double>( - ( TrapezIntegral(N, s[i], omega) - LogTerm )/pi , y);
+    double sum = 0;
+    for (int r=0; r<Nruns; r++)
+      for (int j=runs[2*r]; j<runs[2*r+1]; j++)
+        if (j != i) sum += weights[j] * y[j] / (omega[i] - omega[j]);
+    sum -= y[i] * KKsums[i];
+
+    //the diagonal term is the derivative of Im Y
+    sum += weights[i] * ( y[ i + ( (i < N-1) ? 1 : 0 ) ] - y[ i - ( (i > 0) ? 1 : 0 ) ] )
+                      / ( omega[ i + ( (i < N-1) ? 1 : 0 ) ] - omega[ i - ( (i > 0) ? 1 : 0 ) ] );
 
-    delete [] s[i];
+    Y[i] = complex<double>( - ( sum - LogTerm )/pi , y[i]);
   }
-  delete [] s;
+  delete [] y;
 }
 /*
 void GRID::KramarsKronig(complex<double> Y[])
@@ -257,6 +417,22 @@ double GRID::interpl(double X[], double om)
           return 0.0;
         else
         {
+          if ( (InterpolationOrder >= 4) and (Nlog > 0) )
+          { //interval [k,k+1] holding om, as below
+            int k;
+            if (abs(om) > omega_max)
+              k = (om > 0) ? (int) ( (om - omega_max)/(omega_lin_max-omega_max)*Nlin/2 ) + Nlin/2 + Nlog - 1
+                           : (int) ( (om + omega_lin_max)/(omega_lin_max-omega_max)*Nlin/2 );
+            else if (abs(om) <= omega_min)
+              k = N/2-1;
+            else
+            { int c = (int) ( (Nlog/2.0-1.0) * log(abs(om)/omega_min) / log(omega_max/omega_min) );
+              k = Nlin/2 + ( (om > 0) ? c + Nlog/2 : Nlog/2 - 2 - c );
+            }
+            if (k < 0) k = 0;
+            if (k > N-2) k = N-2;
+            return Cubic(X, k, om);
+          }
 
           if ( (abs(om) > omega_max) && (abs(om) <= omega_lin_max) )  
           {  if (om > 0.0)
@@ -317,10 +493,12 @@ double GRID::interpl(double X[], double om)
      case GridTypes::Linear:
      { if (abs(om) > omega_lin_max) 
           return 0.0;
-       double domega = omega_lin_max / (N-1);
-       int i = (int) (om+omega_lin_max)/domega ; 
+       double domega = 2.0 * omega_lin_max / (N-1);
+       int i = (int) ( (om+omega_lin_max)/domega ); 
+       if (i > N-2) i = N-2;
+       if (InterpolationOrder >= 4) return Cubic(X, i, om);
        double c = om - omega[i];
-       return c * (X[i+1]-X[i]) / domega;
+       return X[i] + c * (X[i+1]-X[i]) / domega;
      } break;
   }
   return 0;
@@ -335,7 +513,8 @@ complex<double> GRID::interpl(complex<double> X[], double om)
     Re[i] = real(X[i]);
     Im[i] = imag(X[i]);
   }
+  complex<double> Y(interpl(Re,om), interpl(Im,om));
   delete [] Re;
   delete [] Im;
-  return complex<double>(interpl(Re,om),interpl(Im,om));
+  return Y;
 }
@@ -1,4 +1,5 @@
 #include <complex>
+#include <atomic>
 
 using namespace std;
 
@@ -26,8 +27,18 @@ class GRID
     double domega_max;
 
     double* omega;
+    double* weights;		//quadrature weights of the omega grid, set by the first assign_omega
+    atomic<int> Nweights;	//released after weights is set, assign_omega may run in parallel
+    double* KKsums;		//sum_{j!=i} w_j / (omega_i - omega_j), set by the first KramarsKronig
+    atomic<int> NKKsums;	//released after KKsums is set
+    int QuadratureOrder;	//2 - trapezoid, 4 - Simpson on each log and lin segment of LogLin and Linear grids
+    int InterpolationOrder;	//2 - linear, 4 - cubic within each segment of LogLin grids
 
     void Defaults();
+    void Init();
+    int get_Segments(int* bounds, bool* logarithmic);	//segments of a LogLin grid, 0 if not applicable
+    void get_Weights(double* w);
+    double Cubic(double X[], int k, double om);	//om between omega[k] and omega[k+1]
     
   public:
     GRID();
@@ -38,14 +49,26 @@ class GRID
     ~GRID();
     
     int get_N() { return N; };
+    int get_GridType() { return GridType; };
+    int get_Nlog() { return Nlog; };
+    int get_Nlin() { return Nlin; };
+    double get_omega_max() { return omega_max; };
+    double get_omega_min() { return omega_min; };
+    double get_domega_min() { return domega_min; };
+    double get_domega_max() { return domega_max; };
     double get_omega(int i);
     double get_omega_lin_max() { return omega_lin_max; };
     double get_domega();
     double get_domega(double omega);
     void assign_omega(double* omega);
+    double* get_weights() { return weights; };
+    void SetQuadratureOrder(int QuadratureOrder);		//before the first assign_omega
+    void SetInterpolationOrder(int InterpolationOrder);
     
     //------routines--------//
-    void KramarsKronig(complex<double> Y[]);
+    void KramarsKronig(complex<double> Y[], int Nt);	//Nt threads
+    double Integrate(const double* Y);		//int Y(omega) domega
+    complex<double> Integrate(const complex<double>* Y);
     complex<double> interpl(complex<double> X[], double om);
     double interpl(double X[], double om);
 };
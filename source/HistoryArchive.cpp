@@ -0,0 +1,337 @@
+#include <cstdio>
+#include <cstring>
+#include <complex>
+#include "HistoryArchive.h"
+#include "Result.h"
+#include "GRID.h"
+
+struct HistoryRecordHeader
+{
+  int it;
+  int keyframe;
+  double n;
+  double mu;
+  double mu0;
+};
+
+const int HistoryFileHeaderSize = 16;	//magic, version, N
+
+//------------------ bit streams ---------------------//
+
+namespace
+{
+  inline unsigned long long Bits(double x)
+  { unsigned long long b;
+    memcpy(&b, &x, 8);
+    return b;
+  }
+
+  inline double Double(unsigned long long b)
+  { double x;
+    memcpy(&x, &b, 8);
+    return x;
+  }
+
+  struct BitWriter
+  { vector<unsigned char>* bytes;
+    unsigned long long acc;	//pending bits, at most 7 between calls
+    int nacc;
+
+    BitWriter(vector<unsigned char>* bytes) : bytes(bytes), acc(0), nacc(0) {}
+
+    void Put(unsigned long long v, int nbits)	//nbits <= 32
+    { acc = (acc << nbits) | (v & ((1ULL << nbits) - 1));
+      nacc += nbits;
+      while (nacc >= 8)
+      { nacc -= 8;
+        bytes->push_back((unsigned char) (acc >> nacc));
+      }
+    }
+
+    void PutLong(unsigned long long v, int nbits)	//nbits <= 64
+    { if (nbits > 32) { Put(v >> 32, nbits - 32); nbits = 32; }
+      Put(v, nbits);
+    }
+
+    void Finish()
+    { if (nacc > 0) bytes->push_back((unsigned char) (acc << (8 - nacc)));
+      acc = 0;
+      nacc = 0;
+    }
+  };
+
+  struct BitReader
+  { const unsigned char* p;
+    const unsigned char* end;
+    unsigned long long acc;
+    int nacc;
+
+    BitReader(const unsigned char* bytes, long long size) : p(bytes), end(bytes+size), acc(0), nacc(0) {}
+
+    unsigned long long Get(int nbits)		//nbits <= 32
+    { while (nacc < nbits)
+      { acc = (acc << 8) | ((p < end) ? *p++ : 0);
+        nacc += 8;
+      }
+      nacc -= nbits;
+      return (acc >> nacc) & ((1ULL << nbits) - 1);
+    }
+
+    unsigned long long GetLong(int nbits)	//nbits <= 64
+    { unsigned long long hi = 0;
+      if (nbits > 32) { hi = Get(nbits - 32) << 32; nbits = 32; }
+      return hi | Get(nbits);
+    }
+  };
+
+  //---- Gorilla: 0 - same as reference, 10 - meaningful bits fit the previous window,
+  //     11 - 5 bits of leading zeros, 6 bits of length-1 and the meaningful bits ----//
+  struct XorState
+  { int lead;
+    int trail;
+    XorState() : lead(-1), trail(0) {}
+  };
+
+  inline void PutXor(BitWriter &w, XorState &s, unsigned long long x)
+  { if (x == 0) { w.Put(0, 1); return; }
+    int lead = __builtin_clzll(x);
+    int trail = __builtin_ctzll(x);
+    if (lead > 31) lead = 31;
+    if ( (s.lead >= 0) and (lead >= s.lead) and (trail >= s.trail) )
+    { w.Put(2, 2);
+      w.PutLong(x >> s.trail, 64 - s.lead - s.trail);
+      return;
+    }
+    int length = 64 - lead - trail;
+    w.Put(3, 2);
+    w.Put(lead, 5);
+    w.Put(length - 1, 6);
+    w.PutLong(x >> trail, length);
+    s.lead = lead;
+    s.trail = trail;
+  }
+
+  inline unsigned long long GetXor(BitReader &r, XorState &s)
+  { if (r.Get(1) == 0) return 0;
+    if (r.Get(1) == 0)
+      return r.GetLong(64 - s.lead - s.trail) << s.trail;
+    s.lead = r.Get(5);
+    int length = r.Get(6) + 1;
+    s.trail = 64 - s.lead - length;
+    return r.GetLong(length) << s.trail;
+  }
+}
+
+//----------------------------------------------------//
+
+HistoryArchive::HistoryArchive()
+{
+  N = 0;
+  KeyframeEvery = 32;
+  data = NULL;
+  index = NULL;
+  Nappended = 0;
+  decoded = -1;
+}
+
+HistoryArchive::~HistoryArchive()
+{
+  Close();
+}
+
+bool HistoryArchive::Create(const char* FN, int N, int KeyframeEvery, bool Append)
+{
+  Close();
+  this->FN.assign(FN);
+  this->N = N;
+  this->KeyframeEvery = (KeyframeEvery < 1) ? 1 : KeyframeEvery;
+  Nappended = 0;
+  last.assign(HistoryFile::Nstreams * N, 0.0);
+  string indexFN = this->FN + ".idx";
+
+  //continue an existing archive of the same size
+  if (Append)
+  { data = fopen(FN, "r+b");
+    if (data != NULL)
+    { char magic[8];
+      int version, N0;
+      bool ok = (fread(magic, 1, 8, data) == 8) and (memcmp(magic, HistoryFile::Magic, 8) == 0)
+                and (fread(&version, sizeof(int), 1, data) == 1) and (version == HistoryFile::Version)
+                and (fread(&N0, sizeof(int), 1, data) == 1) and (N0 == N);
+      index = (ok) ? fopen(indexFN.c_str(), "ab") : NULL;
+      if (index != NULL)
+      { fseek(data, 0, SEEK_END);
+        printf("-- INFO -- HistoryArchive: appending to %s\n", FN);
+        return true;
+      }
+      printf("-- WARNING -- HistoryArchive: %s does not match this run, starting a new archive\n", FN);
+      fclose(data);
+      data = NULL;
+    }
+  }
+
+  data = fopen(FN, "wb");
+  index = fopen(indexFN.c_str(), "wb");
+  if ( (data == NULL) or (index == NULL) )
+  { printf("-- ERROR -- HistoryArchive: could not create %s\n", FN);
+    Close();
+    return false;
+  }
+  fwrite(HistoryFile::Magic, 1, 8, data);
+  fwrite(&HistoryFile::Version, sizeof(int), 1, data);
+  fwrite(&N, sizeof(int), 1, data);
+  fflush(data);
+  return true;
+}
+
+void HistoryArchive::Close()
+{
+  if (data != NULL) fclose(data);
+  if (index != NULL) fclose(index);
+  data = NULL;
+  index = NULL;
+  mapped.Close();
+  entries.clear();
+  decoded = -1;
+}
+
+void HistoryArchive::Gather(Result* r, double* X)
+{
+  for (int i=0; i<N; i++)
+  { X[i]     = real(r->Delta[i]);
+    X[N+i]   = imag(r->Delta[i]);
+    X[2*N+i] = real(r->Sigma[i]);
+    X[3*N+i] = imag(r->Sigma[i]);
+    X[4*N+i] = real(r->G[i]);
+    X[5*N+i] = imag(r->G[i]);
+  }
+}
+
+void HistoryArchive::Encode(const double* X, bool keyframe)
+{
+  buffer.clear();
+  buffer.reserve(HistoryFile::Nstreams * N * 8);
+  BitWriter w(&buffer);
+  for (int s=0; s<HistoryFile::Nstreams; s++)
+  { XorState state;
+    const double* x = X + s*N;
+    double* ref = last.data() + s*N;
+    unsigned long long prev = 0;
+    for (int i=0; i<N; i++)
+    { unsigned long long b = Bits(x[i]);
+      PutXor(w, state, b ^ ((keyframe) ? prev : Bits(ref[i])));
+      prev = b;
+    }
+  }
+  w.Finish();
+}
+
+void HistoryArchive::Decode(const unsigned char* bytes, long long size, bool keyframe)
+{
+  BitReader r(bytes, size);
+  for (int s=0; s<HistoryFile::Nstreams; s++)
+  { XorState xs;
+    double* x = state.data() + s*N;
+    unsigned long long prev = 0;
+    for (int i=0; i<N; i++)
+    { unsigned long long b = GetXor(r, xs) ^ ((keyframe) ? prev : Bits(x[i]));
+      x[i] = Double(b);
+      prev = b;
+    }
+  }
+}
+
+void HistoryArchive::Append(int it, Result* r)
+{
+  if (data == NULL) return;
+
+  HistoryRecordHeader h;
+  h.it = it;
+  h.keyframe = (Nappended % KeyframeEvery == 0) ? 1 : 0;
+  h.n = r->n;
+  h.mu = r->mu;
+  h.mu0 = r->mu0;
+
+  vector<double> X(HistoryFile::Nstreams * N);
+  Gather(r, X.data());
+  Encode(X.data(), h.keyframe);
+  last.swap(X);
+
+  HistoryIndexEntry e;
+  e.it = it;
+  e.keyframe = h.keyframe;
+  e.offset = ftell(data);
+  e.size = buffer.size();
+  fwrite(&h, sizeof(HistoryRecordHeader), 1, data);
+  fwrite(buffer.data(), 1, buffer.size(), data);
+  fflush(data);
+  fwrite(&e, sizeof(HistoryIndexEntry), 1, index);
+  fflush(index);
+  Nappended++;
+}
+
+//------------------ reading -------------------------//
+
+bool HistoryArchive::Open(const char* FN)
+{
+  Close();
+  this->FN.assign(FN);
+  if ( (!mapped.Open(FN)) or (mapped.get_size() < HistoryFileHeaderSize)
+       or (memcmp(mapped.get_data(), HistoryFile::Magic, 8) != 0) )
+  { printf("-- ERROR -- HistoryArchive: %s is not a history archive\n", FN);
+    mapped.Close();
+    return false;
+  }
+  memcpy(&N, mapped.get_data() + 12, sizeof(int));
+  state.assign(HistoryFile::Nstreams * N, 0.0);
+
+  FILE* f = fopen((this->FN + ".idx").c_str(), "rb");
+  if (f == NULL)
+  { printf("-- ERROR -- HistoryArchive: index of %s is missing\n", FN);
+    mapped.Close();
+    return false;
+  }
+  HistoryIndexEntry e;
+  while (fread(&e, sizeof(HistoryIndexEntry), 1, f) == 1)
+    if (e.offset + (long long) sizeof(HistoryRecordHeader) + e.size <= (long long) mapped.get_size())
+      entries.push_back(e);	//records beyond the mapped size were written after Open
+  fclose(f);
+  printf("-- INFO -- HistoryArchive: %d records in %s\n", (int) entries.size(), FN);
+  return true;
+}
+
+bool HistoryArchive::Read(int it, Result* r)
+{
+  for (int k = entries.size()-1; k>=0; k--)
+    if (entries[k].it == it) return ReadRecord(k, r);
+  printf("-- ERROR -- HistoryArchive: iteration %d is not in %s\n", it, FN.c_str());
+  return false;
+}
+
+bool HistoryArchive::ReadRecord(int record, Result* r)
+{
+  if ( (record < 0) or (record >= (int) entries.size()) or (r->grid->get_N() != N) ) return false;
+
+  //decode forward from the last keyframe, or from the record held in state
+  int start = record;
+  while (!entries[start].keyframe) start--;
+  if ( (decoded >= start) and (decoded <= record) ) start = decoded + 1;
+  for (int k = start; k <= record; k++)
+  { const unsigned char* p = (const unsigned char*) mapped.get_data() + entries[k].offset;
+    Decode(p + sizeof(HistoryRecordHeader), entries[k].size, entries[k].keyframe);
+  }
+  decoded = record;
+
+  HistoryRecordHeader h;
+  memcpy(&h, mapped.get_data() + entries[record].offset, sizeof(HistoryRecordHeader));
+  r->n = h.n;
+  r->mu = h.mu;
+  r->mu0 = h.mu0;
+  const double* X = state.data();
+  for (int i=0; i<N; i++)
+  { r->Delta[i] = complex<double>(X[i], X[N+i]);
+    r->Sigma[i] = complex<double>(X[2*N+i], X[3*N+i]);
+    r->G[i] = complex<double>(X[4*N+i], X[5*N+i]);
+  }
+  return true;
+}
@@ -0,0 +1,75 @@
+//*************************************************//
+//    Compressed archive of DMFT iterations        //
+//*************************************************//
+
+// Append-only binary history of Delta, Sigma and G (and n, mu, mu0) of every iteration.
+// Each record is compressed losslessly with Gorilla style XOR encoding: a double is
+// XORed with a reference and only the meaningful bits of the result are stored. In
+// keyframes the reference is the previous point of the same array, in other records it
+// is the same point in the previous record. FN.idx holds the position of every record,
+// so any iteration is decoded from the nearest preceding keyframe.
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+using namespace std;
+
+class Result;
+
+namespace HistoryFile
+{
+  const char Magic[8] = {'D','M','F','T','H','I','S','T'};
+  const int Version = 1;
+  const int Nstreams = 6;	//real and imaginary parts of Delta, Sigma and G
+}
+
+struct HistoryIndexEntry
+{
+  int it;
+  int keyframe;
+  long long offset;		//in the data file
+  long long size;		//compressed bytes
+};
+
+class HistoryArchive
+{
+  private:
+    string FN;
+    int N;
+    int KeyframeEvery;
+
+    //--- writing ---//
+    FILE* data;
+    FILE* index;
+    int Nappended;		//records since Create, the first one is always a keyframe
+    vector<double> last;	//Nstreams*N values of the last appended record
+    vector<unsigned char> buffer;
+
+    //--- reading ---//
+    MappedFile mapped;
+    vector<HistoryIndexEntry> entries;
+    int decoded;		//record held in state, -1 if none
+    vector<double> state;
+
+    void Gather(Result* r, double* X);
+    void Encode(const double* X, bool keyframe);
+    void Decode(const unsigned char* bytes, long long size, bool keyframe);
+
+  public:
+    HistoryArchive();
+    ~HistoryArchive();
+
+    //--- writing: Append keeps the existing records if the file is compatible ---//
+    bool Create(const char* FN, int N, int KeyframeEvery, bool Append = false);
+    void Append(int it, Result* r);
+    void Close();
+
+    //--- reading ---//
+    bool Open(const char* FN);
+    int get_Nrecords() { return entries.size(); };
+    int get_iteration(int record) { return entries[record].it; };
+    bool Read(int it, Result* r);	//last record of iteration it; sequential reads decode one record each
+    bool ReadRecord(int record, Result* r);
+};
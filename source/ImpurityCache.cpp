@@ -0,0 +1,134 @@
+#include <cstdio>
+#include "ImpurityCache.h"
+
+ImpurityCache::ImpurityCache()
+{
+  Initialized = false;
+  Nimp = 0;
+  N = 0;
+}
+
+ImpurityCache::~ImpurityCache()
+{
+  ReleaseMemory();
+}
+
+void ImpurityCache::Initialize(int Nimp, int N, int HistoryDepth)
+{
+  ReleaseMemory();
+
+  this->Nimp = Nimp;
+  this->N = N;
+  this->HistoryDepth = (HistoryDepth < 1) ? 1 : HistoryDepth;
+
+  Nstored = new int[Nimp];
+  KnownMPT_B = new bool[Nimp];
+  mu0s = new double*[Nimp];
+  MPT_Bs = new double*[Nimp];
+  for (int i=0; i<Nimp; i++)
+  { mu0s[i] = new double[this->HistoryDepth];
+    MPT_Bs[i] = new double[this->HistoryDepth];
+  }
+  Initialized = true;
+  Clear();
+}
+
+void ImpurityCache::ReleaseMemory()
+{
+  if (!Initialized) return;
+  for (int i=0; i<Nimp; i++)
+  { delete [] mu0s[i];
+    delete [] MPT_Bs[i];
+  }
+  delete [] mu0s;
+  delete [] MPT_Bs;
+  delete [] Nstored;
+  delete [] KnownMPT_B;
+  Initialized = false;
+}
+
+void ImpurityCache::Clear()
+{ //forget all solutions but keep the allocated arrays
+  for (int i=0; i<Nimp; i++)
+  { Nstored[i] = 0;
+    KnownMPT_B[i] = false;
+    mu0s[i][0] = 0;
+    MPT_Bs[i][0] = 0;
+  }
+}
+
+void ImpurityCache::Store(int imp, double mu0, double MPT_B)
+{
+  //shift history
+  for (int h = HistoryDepth-1; h>0; h--)
+  { mu0s[imp][h] = mu0s[imp][h-1];
+    MPT_Bs[imp][h] = MPT_Bs[imp][h-1];
+  }
+  if (!KnownMPT_B[imp]) Nstored[imp] = 0; //history from a mirror is useless for extrapolation
+  mu0s[imp][0] = mu0;
+  MPT_Bs[imp][0] = MPT_B;
+  KnownMPT_B[imp] = true;
+  if (Nstored[imp] < HistoryDepth) Nstored[imp]++;
+}
+
+bool ImpurityCache::Restore(int imp, double &mu0, double &MPT_B, bool Extrapolate)
+{
+  mu0 = mu0s[imp][0];
+  MPT_B = MPT_Bs[imp][0];
+  if (Nstored[imp] == 0) return false;
+
+  if ( Extrapolate and KnownMPT_B[imp] and (Nstored[imp] >= 2) )
+  { mu0 = 2.0 * mu0s[imp][0] - mu0s[imp][1];
+    MPT_B = 2.0 * MPT_Bs[imp][0] - MPT_Bs[imp][1];
+  }
+
+  return KnownMPT_B[imp];
+}
+
+void ImpurityCache::Mirror(int from, int to)
+{
+  mu0s[to][0] = - mu0s[from][0];
+  Nstored[to] = (Nstored[from] > 0) ? 1 : 0;
+  KnownMPT_B[to] = false;
+}
+
+void ImpurityCache::Save(FILE* f)
+{
+  fwrite(&Initialized, sizeof(bool), 1, f);
+  if (!Initialized) return;
+  fwrite(&Nimp, sizeof(int), 1, f);
+  fwrite(&N, sizeof(int), 1, f);
+  fwrite(&HistoryDepth, sizeof(int), 1, f);
+  fwrite(Nstored, sizeof(int), Nimp, f);
+  fwrite(KnownMPT_B, sizeof(bool), Nimp, f);
+  for (int i=0; i<Nimp; i++)
+  { fwrite(mu0s[i], sizeof(double), HistoryDepth, f);
+    fwrite(MPT_Bs[i], sizeof(double), HistoryDepth, f);
+  }
+}
+
+bool ImpurityCache::Load(FILE* f)
+{
+  bool Saved;
+  if (fread(&Saved, sizeof(bool), 1, f) != 1) return false;
+  if (!Saved) 
+  { ReleaseMemory();
+    Nimp = 0;
+    N = 0;
+    return true;
+  }
+
+  int Nimp, N, HistoryDepth;
+  bool ok = (fread(&Nimp, sizeof(int), 1, f) == 1)
+            and (fread(&N, sizeof(int), 1, f) == 1)
+            and (fread(&HistoryDepth, sizeof(int), 1, f) == 1);
+  if (!ok) return false;
+  Initialize(Nimp, N, HistoryDepth);
+
+  ok = (fread(Nstored, sizeof(int), Nimp, f) == (size_t) Nimp)
+       and (fread(KnownMPT_B, sizeof(bool), Nimp, f) == (size_t) Nimp);
+  for (int i=0; (ok) and (i<Nimp); i++)
+    ok = (fread(mu0s[i], sizeof(double), HistoryDepth, f) == (size_t) HistoryDepth)
+         and (fread(MPT_Bs[i], sizeof(double), HistoryDepth, f) == (size_t) HistoryDepth);
+  return ok;
+}
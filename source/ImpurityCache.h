@@ -0,0 +1,45 @@
+//*************************************************//
+//    Per-impurity warm start state for TMT        //
+//*************************************************//
+
+#include <cstdio>
+
+using namespace std;
+
+class ImpurityCache
+{
+  private:
+    bool Initialized;
+
+    int Nimp;			//number of impurities (cache keys are impurity indices 0..Nimp-1)
+    int N;			//grid size the cache was made for
+    int HistoryDepth;		//number of converged solutions kept per impurity
+
+    int* Nstored;		//Nimp x 1, number of solutions in history
+    double** mu0s;		//Nimp x HistoryDepth, most recent first
+    double** MPT_Bs;		//Nimp x HistoryDepth
+    bool* KnownMPT_B;		//false for mirrored impurities (only mu0 is known)
+
+    void ReleaseMemory();
+  public:
+    ImpurityCache();
+    ~ImpurityCache();
+
+    void Initialize(int Nimp, int N, int HistoryDepth);
+    void Clear();
+
+    int get_Nimp() { return Nimp; };
+    int get_N() { return N; };
+
+    //stores the converged state of impurity imp. (mu0, MPT_B) is all SIAM::Run starts from
+    void Store(int imp, double mu0, double MPT_B);
+    //returns mu0 and MPT_B for a warm start. returns true if MPT_B is known.
+    //with Extrapolate, mu0 and MPT_B are linearly extrapolated from the last two solutions
+    bool Restore(int imp, double &mu0, double &MPT_B, bool Extrapolate);
+    //particle-hole mirror of impurity from: mu0 -> -mu0, MPT_B is dropped
+    void Mirror(int from, int to);
+
+    //checkpointing. Load reallocates the cache to the saved size
+    void Save(FILE* f);
+    bool Load(FILE* f);
+};
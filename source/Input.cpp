@@ -1,9 +1,80 @@
 #include <cstdio>
+#include <cstdlib>
 #include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <fstream>
+#include <sstream>
 #include <iostream>
+#include <sys/stat.h>
 #include "Input.h"
 using namespace std;
 
+struct ParamStore
+{
+  time_t mtime;				//file state when parsed
+  off_t size;
+  vector<string> lines;			//parameter lines without comments
+  vector< vector<string> > values;	//value tokens of each line
+  unordered_map<string, pair<int,int> > index;	//parameter name -> line, first token of the name
+
+  void Parse(const char* InputFN);
+};
+
+void ParamStore::Parse(const char* InputFN)
+{
+  lines.clear();
+  values.clear();
+  index.clear();
+
+  ifstream file(InputFN);
+  string line;
+  while (getline(file, line))
+  { size_t hash = line.find('#');
+    if (hash != string::npos) line.erase(hash);
+
+    vector<string> tokens;
+    istringstream ss(line);
+    string token;
+    while (ss >> token) tokens.push_back(token);
+    if (tokens.empty()) continue;
+
+    //the name may contain spaces and be followed by a description, so every run of
+    //tokens after the first value is a candidate name. The first line defining a name wins.
+    int l = lines.size();
+    for (size_t k=1; k<tokens.size(); k++)
+    { string name = tokens[k];
+      for (size_t m=k; m<tokens.size(); m++)
+      { if (m > k) name += " " + tokens[m];
+        if (index.find(name) == index.end()) index[name] = pair<int,int>(l, k);
+      }
+    }
+
+    string joined;
+    for (size_t k=0; k<tokens.size(); k++) joined += (k==0) ? tokens[k] : " " + tokens[k];
+    lines.push_back(joined);
+    values.push_back(tokens);
+  }
+}
+
+static ParamStore* GetParamStore(const char* InputFN)
+{ //stores are kept for the whole run and reparsed only if the file has changed
+  static map<string, ParamStore*> registry;
+
+  struct stat st;
+  if (stat(InputFN, &st) != 0) return NULL;
+
+  ParamStore* &store = registry[string(InputFN)];
+  if ( (store != NULL) and (store->mtime == st.st_mtime) and (store->size == st.st_size) )
+    return store;
+
+  if (store == NULL) store = new ParamStore();
+  store->mtime = st.st_mtime;
+  store->size = st.st_size;
+  store->Parse(InputFN);
+  return store;
+}
 
 Input::Input(const char* InputFN)
 {
@@ -18,109 +89,113 @@ Input::~Input()
 void Input::SetInputFN(const char* InputFN)
 { 
   this->InputFN.assign(InputFN);
-  FILE* InputFile = fopen(this->InputFN.c_str(),"r");
-  if ( InputFile==NULL )
+  store = GetParamStore(InputFN);
+  if ( store==NULL )
     printf("-- WARNING -- Input: Input File does not exist!\n");
   else
-  {  cout << "-- INFO -- Input: Input File name set to:" << this->InputFN << endl;
-     fclose(InputFile);
+    cout << "-- INFO -- Input: Input File name set to:" << this->InputFN << endl;
+}
+
+const string* Input::ReadParam(const char* ParamName)
+{ 
+  if (store == NULL) return NULL;
+    
+  unordered_map<string, pair<int,int> >::iterator it = store->index.find(string(ParamName));
+  if (it == store->index.end())
+  { printf("-- INFO -- Input: Param %s not found in Input File\n",ParamName);
+    return NULL;
   }
+  return store->values[it->second.first].data();
+}
+
+int Input::get_ArrayLength(const char* ParamName)
+{ //values are the tokens before the name
+  if (store == NULL) return -1;
+  unordered_map<string, pair<int,int> >::iterator it = store->index.find(string(ParamName));
+  if (it == store->index.end()) return -1;
+  return it->second.second;
 }
 
 int Input::ReadArray(int N, double* Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
-
-  int Error = 0;
-  switch (N)
-  {
-    case 0: printf("-- ERROR -- Input: Arrays of 0 elements make no sense!\n"); return -1;
-    case 1: Error = sscanf(line,"%le",                 &(Param[0]) ); break;
-    case 2: Error = sscanf(line,"%le %le",             &(Param[0]), &(Param[1]) ); break;
-    case 3: Error = sscanf(line,"%le %le %le",         &(Param[0]), &(Param[1]), &(Param[2]) ); break;
-    case 4: Error = sscanf(line,"%le %le %le %le",     &(Param[0]), &(Param[1]), &(Param[2]), &(Param[3]) ); break;
-    case 5: Error = sscanf(line,"%le %le %le %le %le", &(Param[0]), &(Param[1]), &(Param[2]), &(Param[3]), &(Param[4]) ); break;
-    default: printf("-- ERROR -- Input: Arrays of more than 5 elements can not be read!\n"); return -1;
-  }
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
+  if (N<=0) { printf("-- ERROR -- Input: Arrays of 0 elements make no sense!\n"); return -1; }
 
-  if ( Error == EOF ) 
-  {  
-     printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
+  if (get_ArrayLength(ParamName) < N) 
+  {  printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
      return -1;    
   }
+  for (int i=0; i<N; i++)
+    Param[i] = strtod(values[i].c_str(), NULL);
   return 0;
 }
 
 int Input::ReadArray(int N, int* Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
-
-  int Error = 0;
-  switch (N)
-  {
-    case 0: printf("-- ERROR -- Input: Arrays of 0 elements make no sense!\n"); return -1;
-    case 1: Error = sscanf(line,"%d",             &(Param[0]) ); break;
-    case 2: Error = sscanf(line,"%d %d",          &(Param[0]), &(Param[1]) ); break;
-    case 3: Error = sscanf(line,"%d %d %d",       &(Param[0]), &(Param[1]), &(Param[2]) ); break;
-    case 4: Error = sscanf(line,"%d %d %d %d",    &(Param[0]), &(Param[1]), &(Param[2]), &(Param[3]) ); break;
-    case 5: Error = sscanf(line,"%d %d %d %d %d", &(Param[0]), &(Param[1]), &(Param[2]), &(Param[3]), &(Param[4]) ); break;
-    default: printf("-- ERROR -- Input: Arrays of more than 5 elements can not be read!\n"); return -1;
-  }
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
+  if (N<=0) { printf("-- ERROR -- Input: Arrays of 0 elements make no sense!\n"); return -1; }
 
-  if ( Error == EOF ) 
-  {  
-     printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
+  if (get_ArrayLength(ParamName) < N) 
+  {  printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
      return -1;    
   }
+  for (int i=0; i<N; i++)
+    Param[i] = strtol(values[i].c_str(), NULL, 10);
   return 0;
 }
 
 int Input::ReadParam(int& Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
 
-  if ( sscanf(line,"%d", &Param) == EOF ) 
+  char* end;
+  long x = strtol(values[0].c_str(), &end, 10);
+  if (end == values[0].c_str()) 
   {  
      printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
      return -1;    
   }
+  Param = x;
   return 0;
 }
 
 int Input::ReadParam(double& Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
 
-  if ( sscanf(line,"%le", &Param) == EOF ) 
+  char* end;
+  double x = strtod(values[0].c_str(), &end);
+  if (end == values[0].c_str()) 
   {  
      printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
      return -1;    
   }
+  Param = x;
   return 0;
 }
 
 int Input::ReadParam(char& Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
 
-  Param = line[0]; 
+  Param = values[0][0]; 
   return 0;
 }
 
 int Input::ReadParam(bool& Param, const char* ParamName)
 {
-  char* line = ReadParam(ParamName);
-  if (line==NULL) return -1;
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
 
-  if (line[0]=='T')
+  if (values[0][0]=='T')
     Param = true;
   else 
-    if (line[0]=='F')
+    if (values[0][0]=='F')
       Param = false;
     else
     {  printf("-- ERROR -- Input: Param %s can not be read\n",ParamName);
@@ -129,21 +204,20 @@ int Input::ReadParam(bool& Param, const char* ParamName)
   return 0;
 }
 
+int Input::ReadParam(string& Param, const char* ParamName)
+{
+  const string* values = ReadParam(ParamName);
+  if (values==NULL) return -1;
 
-char* Input::ReadParam(const char* ParamName)
-{ 
-  FILE* InputFile = fopen(InputFN.c_str(),"r");
-  if ( InputFile==NULL ) return NULL;
-    
-  char* line = new char[128];
-  while ( fgets(line, 128, InputFile ) != NULL ) 
-  { if (line[0]=='#') continue;
-    string sline(line);
-    if ( sline.find(ParamName) != string::npos )
-      return line;
-  }
-  delete [] line;
-  fclose (InputFile);
-  printf("-- INFO -- Input: Param %s not found in Input File\n",ParamName);
-  return NULL;
+  Param = values[0];
+  return 0;
+}
+
+string Input::Serialize()
+{
+  string s;
+  if (store == NULL) return s;
+  for (size_t l=0; l<store->lines.size(); l++)
+    s += store->lines[l] + "\n";
+  return s;
 }
@@ -1,6 +1,15 @@
 #include <iostream>
+#include <string>
 using namespace std;
 
+struct ParamStore;
+
+// Params files have one parameter per line: values first, then the name, e.g.
+//   1.5 CHM::U
+//   1 1 Loop::Coefs
+// Everything after '#' is a comment. A file is parsed once into an index of exact
+// parameter names that is shared by all Input objects reading the same file.
+
 class Input
 {  
    public:
@@ -13,10 +22,15 @@ class Input
      int ReadParam(int& Param, const char* ParamName);
      int ReadParam(char& Param, const char* ParamName);
      int ReadParam(bool& Param, const char* ParamName); 
+     int ReadParam(string& Param, const char* ParamName);	//first value, e.g. a file name
      int ReadArray(int N, double* Param, const char* ParamName);
      int ReadArray(int N, int* Param, const char* ParamName);
+     int get_ArrayLength(const char* ParamName);	//number of values, -1 if not found
+
+     string Serialize();	//all parameters, one per line, in file order
 
    private:
      string InputFN;
-     char* ReadParam(const char* ParamName);
+     ParamStore* store;
+     const string* ReadParam(const char* ParamName);	//values of the parameter, NULL if not found
 };
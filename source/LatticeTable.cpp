@@ -0,0 +1,380 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <map>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "LatticeTable.h"
+#include "routines.h"
+
+const int LatticeTableHeaderSize = 64;
+
+string LatticeTable::Dir = "lattice";
+
+LatticeTable::LatticeTable()
+{
+  header = NULL;
+}
+
+bool LatticeTable::HasTable(int DOStype)
+{ //lattices whose DOS is expensive to evaluate
+  return (DOStype == DOStypes::SquareLattice) or (DOStype == DOStypes::CubicLattice);
+}
+
+double LatticeTable::HalfBandwidth(int DOStype, double t)
+{
+  switch (DOStype)
+  { case DOStypes::SemiCircle: return 2*t;
+    case DOStypes::Gaussian: return 6*t;
+    case DOStypes::Insulator: return 2.5 + 2*t;
+    case DOStypes::SquareLattice: return 4*t;
+    case DOStypes::CubicLattice: return 6*t;
+    default: { printf("-- ERROR -- LatticeTable: DOStype %d has no bandwidth\n", DOStype); exit(1); }
+  }
+}
+
+void LatticeTable::SetDir(const char* Dir)
+{
+  LatticeTable::Dir.assign(Dir);
+}
+
+LatticeTable* LatticeTable::Get(int DOStype, double t)
+{
+  static map< pair<int,double>, LatticeTable* > tables;
+  LatticeTable* table;
+  #pragma omp critical(LatticeTableGet)
+  {
+    LatticeTable* &entry = tables[pair<int,double>(DOStype, t)];
+    if (entry == NULL)
+    { entry = new LatticeTable();
+      if (!entry->Open(DOStype, t)) { printf("-- ERROR -- LatticeTable: no table for DOStype %d\n", DOStype); exit(1); }
+    }
+    table = entry;
+  }
+  return table;
+}
+
+bool LatticeTable::Open(int DOStype, double t)
+{
+  char FN[300];
+  snprintf(FN, 300, "%s/lattice.%d.t%.6f.v%d", Dir.c_str(), DOStype, t, LatticeTableFile::Version);
+
+  for (int attempt=0; attempt<2; attempt++)
+  { if (file.Open(FN))
+    { const LatticeTableHeader* H = (const LatticeTableHeader*) file.get_data();
+      bool ok = (file.get_size() >= LatticeTableHeaderSize)
+                and (memcmp(H->magic, LatticeTableFile::Magic, 8) == 0)
+                and (H->version == LatticeTableFile::Version) and (H->DOStype == DOStype) and (H->t == t)
+                and (H->Nlevels == get_Nlevels(H->Npoints)) and (H->Nmoments == LatticeTableFile::Nmoments)
+                and (file.get_size() == LatticeTableHeaderSize + get_DataSize(H->Npoints) * sizeof(double));
+      if (ok)
+      { Attach(H, (const double*) (file.get_data() + LatticeTableHeaderSize));
+        return true;
+      }
+      file.Close();
+    }
+    if ( (attempt == 0) and (!Generate(FN, DOStype, t)) ) return false;
+  }
+  return false;
+}
+
+void LatticeTable::Attach(const LatticeTableHeader* H, const double* data)
+{
+  header = H;
+  int N = H->Npoints;
+  int L = H->Nlevels;
+  dos = data;
+  ddos = dos + N;
+  ReG = dos + 2*N;
+  dReG = dos + 3*N;
+  levels = dos + 4*N;
+  Gz = (const complex<double>*) (levels + L);
+  dGz = Gz + L*N;
+  moments = (const double*) (dGz + L*N);
+  h = 2.0 * H->omega_max / N;
+}
+
+int LatticeTable::get_Nlevels(int N)
+{ //y = 0, h, h*LevelRatio, ... until omega_max = N*h/2 is reached
+  int L = 2;
+  for (double y = 1.0; y < 0.5*N; y *= LatticeTableFile::LevelRatio) L++;
+  return L;
+}
+
+long LatticeTable::get_DataSize(int N)
+{
+  int L = get_Nlevels(N);
+  return 4L*N + L + 4L*L*N + LatticeTableFile::Nmoments;
+}
+
+//---- monotone cubic Hermite (Fritsch-Carlson) derivatives on an equidistant grid ----//
+static void PCHIPDerivatives(int N, const double* y, double h, double* dy)
+{
+  for (int i=1; i<N-1; i++)
+  { double s0 = (y[i] - y[i-1]) / h;
+    double s1 = (y[i+1] - y[i]) / h;
+    dy[i] = (s0*s1 > 0) ? 2.0*s0*s1 / (s0 + s1) : 0.0;
+  }
+  dy[0] = (y[1] - y[0]) / h;
+  dy[N-1] = (y[N-1] - y[N-2]) / h;
+}
+
+void LatticeTable::Tabulate(int N, double omega_max, double* data)
+{ //data holds the dos on the N points, the rest of the table is computed from it
+  double h = 2.0 * omega_max / N;
+  int L = get_Nlevels(N);
+  double* dos = data;
+  double* ddos = data + N;
+  double* ReG = data + 2*N;
+  double* dReG = data + 3*N;
+  double* levels = data + 4*N;
+  complex<double>* Gz = (complex<double>*) (levels + L);
+  complex<double>* dGz = Gz + L*N;
+  double* moments = (double*) (dGz + L*N);
+
+  //points are in the middle of N cells covering [-omega_max, omega_max]
+  double* e = new double[N];
+  for (int i=0; i<N; i++) e[i] = -omega_max + (i + 0.5) * h;
+
+  //the sums over e run over the support of the DOS only, i.e. the runs of points where
+  //dos or its derivative is nonzero. Where both vanish the point contributes nothing,
+  //except through dos[i] * sum_j 1/(z-e_j), which is summed in closed form: harmonic
+  //numbers on the real axis, psi(u+1) - psi(u-N+1) with u = (z-e_0)/h off the axis
+  PCHIPDerivatives(N, dos, h, ddos);
+  vector<int> runs;
+  for (int j=0; j<N; j++)
+    if ( (dos[j] != 0.0) or (ddos[j] != 0.0) )
+    { if ( (runs.size() == 0) or (runs.back() != j) ) { runs.push_back(j); runs.push_back(j+1); }
+      else runs.back() = j+1;
+    }
+  int Nruns = runs.size() / 2;
+  double* H = new double[N];	//harmonic numbers
+  H[0] = 0;
+  for (int n=1; n<N; n++) H[n] = H[n-1] + 1.0 / n;
+
+  //principal value integral, the singular part is integrated analytically
+  #pragma omp parallel for
+  for (int i=0; i<N; i++)
+  { double sum = 0;
+    for (int r=0; r<Nruns; r++)
+      for (int j=runs[2*r]; j<runs[2*r+1]; j++)
+        if (j != i) sum += dos[j] / (e[i] - e[j]);
+    sum -= dos[i] * (H[i] - H[N-1-i]) / h;
+    if ( (i > 0) and (i < N-1) ) sum -= 0.5 * (dos[i+1] - dos[i-1]) / h;
+    ReG[i] = h * sum + dos[i] * log( (e[i] + omega_max) / (omega_max - e[i]) );
+  }
+
+  PCHIPDerivatives(N, ReG, h, dReG);
+
+  //off the real axis, G' = int de DOS'(e) / (z - e) since the DOS vanishes at the ends
+  levels[0] = 0.0;
+  for (int i=0; i<N; i++)
+  { Gz[i] = complex<double>(ReG[i], -pi * dos[i]);
+    dGz[i] = complex<double>(dReG[i], -pi * ddos[i]);
+  }
+  for (int k=1; k<L; k++)
+  { levels[k] = (k == 1) ? h : levels[k-1] * LatticeTableFile::LevelRatio;
+    #pragma omp parallel for
+    for (int i=0; i<N; i++)
+    { double y = levels[k];
+      double y2 = y*y;
+      double re = 0, im = 0, dre = 0, dim = 0;
+      for (int r=0; r<Nruns; r++)
+        for (int j=runs[2*r]; j<runs[2*r+1]; j++)
+        { //1/(z-e) = (x-e-iy)/((x-e)^2+y^2), spelled out as complex division is slow
+          double dx = e[i] - e[j];
+          double w = 1.0 / (dx*dx + y2);
+          double f = dos[j] * w;
+          double df = ddos[j] * w;
+          re += f * dx;
+          im -= f * y;
+          dre += df * dx;
+          dim -= df * y;
+        }
+      complex<double> z(e[i], y);
+      complex<double> LogTerm = log( (z + omega_max) / (z - omega_max) );
+      complex<double> Gsum = h * complex<double>(re, im);
+      complex<double> dGsum = h * complex<double>(dre, dim);
+      if ( (dos[i] != 0.0) or (ddos[i] != 0.0) )
+      { complex<double> u(i, y / h);
+        complex<double> Sum = Digamma(u + 1.0) - Digamma(u - (N - 1.0));	//h sum_j 1/(z-e_j)
+        Gsum += dos[i] * (LogTerm - Sum);
+        dGsum += ddos[i] * (LogTerm - Sum);
+      }
+      Gz[k*N + i] = Gsum;
+      dGz[k*N + i] = dGsum;
+    }
+  }
+
+  for (int k=0; k<LatticeTableFile::Nmoments; k++)
+  { double sum = 0;
+    for (int r=0; r<Nruns; r++)
+      for (int j=runs[2*r]; j<runs[2*r+1]; j++) sum += dos[j] * pow(e[j], k);
+    moments[k] = h * sum;
+  }
+
+  delete [] e;
+  delete [] H;
+}
+
+bool LatticeTable::Generate(const char* FN, int DOStype, double t)
+{
+  int N = LatticeTableFile::Npoints;
+  double omega_max = LatticeTableFile::Range * HalfBandwidth(DOStype, t);
+  double h = 2.0 * omega_max / N;
+  printf("-- INFO -- LatticeTable: generating %s\n", FN);
+
+  long size = get_DataSize(N);
+  double* data = new double[size];
+  #pragma omp parallel for schedule(dynamic)
+  for (int i=0; i<N; i++) data[i] = DOS(DOStype, t, -omega_max + (i + 0.5) * h);
+  Tabulate(N, omega_max, data);
+
+  LatticeTableHeader H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.magic, LatticeTableFile::Magic, 8);
+  H.version = LatticeTableFile::Version;
+  H.DOStype = DOStype;
+  H.Npoints = N;
+  H.Nlevels = get_Nlevels(N);
+  H.t = t;
+  H.omega_max = omega_max;
+  H.Nmoments = LatticeTableFile::Nmoments;
+
+  //written under a private name and renamed, so processes generating the same table do not collide
+  mkdir(Dir.c_str(), 0755);
+  char tmpFN[320];
+  snprintf(tmpFN, 320, "%s.tmp.%d", FN, (int) getpid());
+  FILE* f = fopen(tmpFN, "wb");
+  bool ok = (f != NULL);
+  if (ok)
+  { char pad[LatticeTableHeaderSize];
+    memset(pad, 0, LatticeTableHeaderSize);
+    memcpy(pad, &H, sizeof(H));
+    ok = (fwrite(pad, 1, LatticeTableHeaderSize, f) == LatticeTableHeaderSize)
+         and (fwrite(data, sizeof(double), size, f) == (size_t) size);
+    ok = (fclose(f) == 0) and ok;
+    ok = ok and (rename(tmpFN, FN) == 0);
+  }
+  if (!ok) printf("-- ERROR -- LatticeTable: can not write %s\n", FN);
+
+  delete [] data;
+  return ok;
+}
+
+void LatticeTable::Build(int N, const double* omega, const double* dos)
+{ //the table spans Range times the support of the DOS, so the moment expansion converges
+  double support = 0;
+  for (int i=0; i<N; i++)
+    if ( (dos[i] != 0.0) and (abs(omega[i]) > support) ) support = abs(omega[i]);
+  if (support == 0) support = abs(omega[N-1]);
+
+  int Npoints = min(LatticeTableFile::Npoints, 2*N);	//no finer than the source needs
+  double omega_max = LatticeTableFile::Range * support;
+  double h = 2.0 * omega_max / Npoints;
+
+  data.assign(get_DataSize(Npoints), 0.0);
+  for (int i=0; i<Npoints; i++)
+    data[i] = interpl(N, (double*) dos, (double*) omega, -omega_max + (i + 0.5) * h);
+  Tabulate(Npoints, omega_max, data.data());
+
+  file.Close();
+  memset(&built, 0, sizeof(built));
+  memcpy(built.magic, LatticeTableFile::Magic, 8);
+  built.version = LatticeTableFile::Version;
+  built.DOStype = DOStypes::FromFile;
+  built.Npoints = Npoints;
+  built.Nlevels = get_Nlevels(Npoints);
+  built.omega_max = omega_max;
+  built.Nmoments = LatticeTableFile::Nmoments;
+  Attach(&built, data.data());
+}
+
+double LatticeTable::Hermite(const double* y, const double* dy, double om)
+{
+  int N = header->Npoints;
+  double x = (om + header->omega_max) / h - 0.5;
+  if (x <= 0) return y[0];
+  if (x >= N-1) return y[N-1];
+  int i = (int) x;
+  double s = x - i;
+  double s2 = s*s;
+  double s3 = s2*s;
+  return (2*s3 - 3*s2 + 1) * y[i] + (s3 - 2*s2 + s) * h * dy[i]
+         + (3*s2 - 2*s3) * y[i+1] + (s3 - s2) * h * dy[i+1];
+}
+
+complex<double> LatticeTable::DirectG(double om)
+{
+  double sum = 0;
+  for (int j=0; j<header->Npoints; j++)
+    sum += dos[j] / (om + header->omega_max - (j + 0.5) * h);
+  return h * sum;
+}
+
+complex<double> LatticeTable::DirectG(complex<double> z)
+{
+  complex<double> sum = 0.0;
+  for (int j=0; j<header->Npoints; j++)
+    sum += dos[j] / (z + header->omega_max - (j + 0.5) * h);
+  return h * sum;
+}
+
+complex<double> LatticeTable::MomentG(complex<double> z)
+{
+  complex<double> w = 1.0 / z;
+  complex<double> sum = 0.0;
+  for (int k = header->Nmoments-1; k>=0; k--) sum = sum * w + moments[k];
+  return sum * w;
+}
+
+double LatticeTable::get_DOS(double om)
+{
+  if (abs(om) >= header->omega_max) return 0.0;
+  return Hermite(dos, ddos, om);
+}
+
+complex<double> LatticeTable::get_G(double om)
+{
+  if (abs(om) >= header->omega_max) return DirectG(om);
+  return complex<double>(Hermite(ReG, dReG, om), -pi * Hermite(dos, ddos, om));
+}
+
+complex<double> LatticeTable::get_G(complex<double> z)
+{
+  if (imag(z) < 0) return conj(get_G(conj(z)));
+  if (abs(z) >= header->omega_max) return MomentG(z);
+
+  int N = header->Npoints;
+  double x = (real(z) + header->omega_max) / h - 0.5;
+  if ( (x < 0) or (x > N-1) ) return DirectG(z);	//within half a cell of the edge
+  int i = (int) x;
+  if (i == N-1) i = N-2;
+  double s = x - i;
+  double s2 = s*s;
+  double s3 = s2*s;
+
+  //levels k and k+1 enclose y, the last level is beyond omega_max
+  double y = imag(z);
+  int k = (y < h) ? 0 : 1 + (int) floor( log(y/h) / log(LatticeTableFile::LevelRatio) );
+  if (k > header->Nlevels-2) k = header->Nlevels-2;
+
+  complex<double> G[2], dG[2];
+  for (int l=0; l<2; l++)
+  { const complex<double>* g = Gz + (k+l)*N + i;
+    const complex<double>* dg = dGz + (k+l)*N + i;
+    G[l] = (2*s3 - 3*s2 + 1) * g[0] + (s3 - 2*s2 + s) * h * dg[0]
+           + (3*s2 - 2*s3) * g[1] + (s3 - s2) * h * dg[1];
+    dG[l] = (1-s) * dg[0] + s * dg[1];
+  }
+
+  //Hermite in y with dG/dy = i G'
+  double dy = levels[k+1] - levels[k];
+  double u = (y - levels[k]) / dy;
+  double u2 = u*u;
+  double u3 = u2*u;
+  complex<double> I(0.0, dy);
+  return (2*u3 - 3*u2 + 1) * G[0] + (u3 - 2*u2 + u) * I * dG[0]
+         + (3*u2 - 2*u3) * G[1] + (u3 - u2) * I * dG[1];
+}
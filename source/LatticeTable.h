@@ -0,0 +1,88 @@
+//*************************************************//
+//    Tabulated lattice DOS and Hilbert transform  //
+//*************************************************//
+
+// DOS(omega) and G(omega) = int de DOS(e) / (omega - e + i0) of a lattice are computed
+// once on an equidistant grid, stored under Dir and memory mapped by later runs. Values
+// in between are interpolated with monotone cubic (PCHIP) Hermite splines, whose
+// derivatives are stored with the table. Tables are generated in parallel with OpenMP.
+//
+// For complex z the table also holds G(x+iy) and G'(x+iy) on the same x points for a
+// geometric sequence of levels y. G is interpolated with cubic Hermite splines in x and,
+// since dG/dy = i G', in y. Far from the band (|z| >= omega_max) the moment expansion
+// G(z) = sum_k m_k / z^(k+1) is used. Build tabulates a sampled DOS in memory, e.g. one
+// read from a file.
+
+#include <complex>
+#include <string>
+#include <vector>
+#include "MappedFile.h"
+
+using namespace std;
+
+namespace LatticeTableFile
+{
+  const char Magic[8] = {'D','M','F','T','L','A','T','T'};
+  const int Version = 2;
+  const int Npoints = 4000;	//even, so that no point falls on a singularity at omega=0
+  const double Range = 2.0;	//tables span [-Range*HalfBandwidth, Range*HalfBandwidth]
+  const double LevelRatio = 1.1;	//y levels are 0, h, h*LevelRatio, ... up to omega_max
+  const int Nmoments = 48;	//terms of the moment expansion, converges as Range^-k
+}
+
+struct LatticeTableHeader
+{
+  char magic[8];
+  int version;
+  int DOStype;
+  int Npoints;
+  int Nlevels;
+  double t;
+  double omega_max;
+  int Nmoments;
+  int pad;
+};
+
+class LatticeTable
+{
+  private:
+    static string Dir;
+
+    MappedFile file;
+    LatticeTableHeader built;		//header of a table made by Build
+    vector<double> data;		//and its data
+    const LatticeTableHeader* header;
+    const double* dos;		//Npoints each
+    const double* ddos;		//derivatives for the Hermite splines
+    const double* ReG;
+    const double* dReG;
+    const double* levels;	//Nlevels values of y
+    const complex<double>* Gz;	//Nlevels rows of Npoints, the first one on the real axis
+    const complex<double>* dGz;
+    const double* moments;	//Nmoments
+    double h;
+
+    static int get_Nlevels(int N);
+    static long get_DataSize(int N);	//doubles following the header
+    static void Tabulate(int N, double omega_max, double* data);	//everything from dos
+    void Attach(const LatticeTableHeader* H, const double* data);
+    bool Generate(const char* FN, int DOStype, double t);
+    double Hermite(const double* y, const double* dy, double om);
+    complex<double> DirectG(double om);		//outside the table
+    complex<double> DirectG(complex<double> z);
+    complex<double> MomentG(complex<double> z);
+
+  public:
+    LatticeTable();
+
+    static bool HasTable(int DOStype);
+    static double HalfBandwidth(int DOStype, double t);
+    static void SetDir(const char* Dir);
+    static LatticeTable* Get(int DOStype, double t);	//opened on first use and kept. Not thread safe
+
+    bool Open(int DOStype, double t);	//maps the table, generating it first if needed
+    void Build(int N, const double* omega, const double* dos);	//tabulates a DOS given on any grid
+    double get_DOS(double om);
+    complex<double> get_G(double om);	//retarded, on the real axis
+    complex<double> get_G(complex<double> z);	//int de DOS(e) / (z - e)
+};
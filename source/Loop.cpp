@@ -4,6 +4,13 @@
 #include "Input.h"
 #include "GRID.h"
 #include "Loop.h"
+#include "AsyncWriter.h"
+#include "HistoryArchive.h"
+#include <cstring>
+#include <sstream>
+#include <vector>
+#include <algorithm>
+#include <unistd.h>
 
 void Loop::Defaults()
 {
@@ -26,6 +33,19 @@ void Loop::Defaults()
     PrintIntermediate = false;
     HaltOnIterations = false;
     ForceSymmetry = false;
+    AsyncOutput = true;
+    OutputQueueDepth = 4;
+    writer = new AsyncWriter();
+    ArchiveHistory = false;
+    HistoryFN = "history";
+    HistoryKeyframeEvery = 32;
+    history = new HistoryArchive();
+
+    //---- Checkpoint/restart ----//
+    CheckpointEvery = 0;
+    CheckpointFN = "checkpoint";
+    Resume = false;
+    ParamsHash = Hash(NULL, 0);
 }
 
 Loop::Loop()
@@ -49,6 +69,7 @@ Loop::Loop(const char* ParamsFN)
   delete [] Coefs;
   Coefs = new int[NtoMix];
   Coefs[0] = 1;
+  for (int i=1; i<NtoMix; i++) Coefs[i] = 0;
   printf("-------- LOOP:: C0 = %d, C1 = %d\n",Coefs[0],Coefs[1]);   
   input.ReadArray(NtoMix, Coefs, "Loop::Coefs");
   input.ReadParam(MAX_ITS,"Loop::MAX_ITS");
@@ -56,6 +77,34 @@ Loop::Loop(const char* ParamsFN)
   input.ReadParam(PrintIntermediate,"Loop::PrintIntermediate");
   input.ReadParam(HaltOnIterations,"Loop::HaltOnIterations");
   input.ReadParam(ForceSymmetry,"Loop::ForceSymmetry");
+  input.ReadParam(AsyncOutput,"Loop::AsyncOutput");
+  input.ReadParam(OutputQueueDepth,"Loop::OutputQueueDepth");
+  writer->SetOptions(AsyncOutput, OutputQueueDepth);
+  input.ReadParam(ArchiveHistory,"Loop::ArchiveHistory");
+  input.ReadParam(HistoryFN,"Loop::HistoryFN");
+  input.ReadParam(HistoryKeyframeEvery,"Loop::HistoryKeyframeEvery");
+  input.ReadParam(CheckpointEvery,"Loop::CheckpointEvery");
+  input.ReadParam(CheckpointFN,"Loop::CheckpointFN");
+  input.ReadParam(Resume,"Loop::Resume");
+
+  //params lines, sorted, without the options that may change when a run is restarted
+  const char* Restart[] = { "Loop::Resume", "Loop::CheckpointEvery", "Loop::CheckpointFN", "Loop::MAX_ITS" };
+  vector<string> lines;
+  istringstream ss(input.Serialize());
+  string line;
+  while (getline(ss, line))
+  { bool Excluded = false;
+    istringstream ls(line);
+    string token;
+    ls >> token;		//first value
+    while (ls >> token)
+      for (int i=0; i<4; i++)
+        if (token == Restart[i]) Excluded = true;
+    if (!Excluded) lines.push_back(line);
+  }
+  sort(lines.begin(), lines.end());
+  for (size_t i=0; i<lines.size(); i++)
+    ParamsHash = Hash(lines[i].c_str(), lines[i].size() + 1, ParamsHash);
   
   printf("HOI: %s PI: %s\n", (HaltOnIterations) ? "yes" : "no", (PrintIntermediate) ? "yes" : "no");
 }
@@ -64,6 +113,8 @@ void Loop::ReleaseMemory()
 {
   printf("Loop release\n");
   delete [] Coefs;
+  delete writer;
+  delete history;
 }
 
 Loop::~Loop()
@@ -108,6 +159,122 @@ void Loop::SetPrintOutOptions(bool PrintIntermediate, bool HaltOnIterations)
   if (HaltOnIterations) printf("-- INFO -- Loop: Halt on iterations set ON\n");
 }
 
+void Loop::SetOutputOptions(bool AsyncOutput, int OutputQueueDepth)
+{
+  this->AsyncOutput = AsyncOutput;
+  this->OutputQueueDepth = OutputQueueDepth;
+  writer->SetOptions(AsyncOutput, OutputQueueDepth);
+}
+
+void Loop::SetHistoryOptions(bool ArchiveHistory, const char* HistoryFN, int HistoryKeyframeEvery)
+{
+  this->ArchiveHistory = ArchiveHistory;
+  this->HistoryFN.assign(HistoryFN);
+  this->HistoryKeyframeEvery = HistoryKeyframeEvery;
+}
+
+void Loop::SetCheckpointOptions(int CheckpointEvery, const char* CheckpointFN, bool Resume)
+{
+  this->CheckpointEvery = CheckpointEvery;
+  this->CheckpointFN.assign(CheckpointFN);
+  this->Resume = Resume;
+}
+
+//---------------------------------------------------//
+
+namespace Checkpoint
+{
+  const char Magic[9] = "DMFTCKPT";
+  const int Version = 3;
+}
+
+unsigned long long Loop::Hash(const void* data, size_t size, unsigned long long hash)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  for (size_t i=0; i<size; i++)
+  { hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+unsigned long long Loop::get_RunHash()
+{
+  return Hash(&N, sizeof(int), ParamsHash);
+}
+
+bool Loop::SaveCheckpoint(int it, int BroydenStatus, Mixer< complex<double> >* mixer, Broyden* B)
+{ //written to a temporary file and renamed, so an interrupted write never replaces a good checkpoint
+  string tmpFN = CheckpointFN + ".tmp";
+  FILE* f = fopen(tmpFN.c_str(), "wb");
+  if (f == NULL) { printf("-- ERROR -- Loop: could not open %s\n", tmpFN.c_str()); return false; }
+
+  fwrite(Checkpoint::Magic, 1, 8, f);
+  fwrite(&Checkpoint::Version, sizeof(int), 1, f);
+  unsigned long long RunHash = get_RunHash();
+  fwrite(&RunHash, sizeof(RunHash), 1, f);
+  fwrite(&N, sizeof(int), 1, f);
+  fwrite(&it, sizeof(int), 1, f);
+  fwrite(&BroydenStatus, sizeof(int), 1, f);
+  r->Save(f);
+  mixer->Save(f);
+  B->Save(f);
+  SaveState(f);
+
+  bool ok = (fflush(f) == 0) and (ferror(f) == 0) and (fsync(fileno(f)) == 0);
+  ok = (fclose(f) == 0) and ok;
+  if ( (!ok) or (rename(tmpFN.c_str(), CheckpointFN.c_str()) != 0) )
+  { printf("-- ERROR -- Loop: checkpoint %s could not be written\n", CheckpointFN.c_str()); 
+    return false;
+  }
+  printf("-- INFO -- Loop: checkpoint written to %s, next iteration %d\n", CheckpointFN.c_str(), it);
+  return true;
+}
+
+bool Loop::LoadCheckpoint(int &it, int &BroydenStatus, Mixer< complex<double> >* mixer, Broyden* B)
+{
+  FILE* f = fopen(CheckpointFN.c_str(), "rb");
+  if (f == NULL) 
+  { printf("-- INFO -- Loop: no checkpoint %s, starting from the initial guess\n", CheckpointFN.c_str()); 
+    return false;
+  }
+
+  char magic[8];
+  int version, N;
+  unsigned long long RunHash;
+  bool ok = (fread(magic, 1, 8, f) == 8) and (memcmp(magic, Checkpoint::Magic, 8) == 0)
+            and (fread(&version, sizeof(int), 1, f) == 1) and (version == Checkpoint::Version)
+            and (fread(&RunHash, sizeof(RunHash), 1, f) == 1) and (RunHash == get_RunHash())
+            and (fread(&N, sizeof(int), 1, f) == 1) and (N == this->N);
+  if (!ok)
+  { printf("-- WARNING -- Loop: checkpoint %s belongs to another run, starting from the initial guess\n", CheckpointFN.c_str()); 
+    fclose(f);
+    return false;
+  }
+
+  //past the header the arrays are overwritten, a failure leaves no valid state
+  ok = (fread(&it, sizeof(int), 1, f) == 1)
+       and (fread(&BroydenStatus, sizeof(int), 1, f) == 1)
+       and r->Load(f) and mixer->Load(f) and B->Load(f) and LoadState(f);
+  fclose(f);
+
+  if (!ok) 
+  { printf("-- ERROR -- Loop: checkpoint %s is corrupt\n", CheckpointFN.c_str()); 
+    exit(1); 
+  }
+  printf("-- INFO -- Loop: resuming from %s at iteration %d\n", CheckpointFN.c_str(), it);
+  return true;
+}
+
+void Loop::SaveState(FILE*)
+{
+}
+
+bool Loop::LoadState(FILE*)
+{
+  return true;
+}
+
 //---------------------------------------------------//
 
 bool Loop::Run(Result* r)
@@ -129,13 +296,19 @@ bool Loop::Run(Result* r)
   //                 1 - Running
   //                 2 - Suspended
   
+  //continue an interrupted run
+  int FirstIt = 1;
+  bool Resumed = (Resume) and LoadCheckpoint(FirstIt, BroydenStatus, &mixer, &B);
+
+  //a resumed run continues the history of the interrupted one
+  if (ArchiveHistory) history->Create(HistoryFN.c_str(), N, HistoryKeyframeEvery, Resumed);
 
   //Halt on first iteration if HaltOnIterations
   int Halt = (HaltOnIterations) ? 1 : 0; 
 
   bool converged = false;
   //------------ DMFT loop-------------//
-  for (int it = 1; it<=MAX_ITS; it++)
+  for (int it = FirstIt; it<=MAX_ITS; it++)
   {  printf("--- DMFT Loop Iteration %d ---\n", it);
      
     //set accr for siam broyden
@@ -144,7 +317,7 @@ bool Loop::Run(Result* r)
     */
     
      //----- solve SIAM ------//
-     if ( SolveSIAM() ) return true;
+     if ( SolveSIAM() ) { writer->Flush(); return true; }
 
 // =========     TODO    ========= Handling errors in SIAM
 /*     if ( SolveSIAM() and (BroydenStatus == 1) and (!ForceBroyden) ) //if clipping, turn off broyden, unless broyden is forced
@@ -157,7 +330,8 @@ bool Loop::Run(Result* r)
      //halt
      if (it==Halt)
      {
-       r->PrintResult("intermediate");
+       writer->Write(r, "intermediate");
+       writer->Flush();
        printf("Next stop: ");
        cin >> Halt; 
      }
@@ -167,8 +341,9 @@ bool Loop::Run(Result* r)
      {  char FN[50];
         sprintf(FN,"intermediate.%d", it);
         //sprintf(FN,"intermediate");
-        r->PrintResult(FN);
+        writer->Write(r, FN);
      }
+     if (ArchiveHistory) history->Append(it, r);
 
      //--- self-consistency ---// 
      CalcDelta(); 
@@ -176,7 +351,7 @@ bool Loop::Run(Result* r)
 
      // check for nans
      //#pragma omp parallel for
-     for (int i = 0; i < N; i++) if ( r->Delta[i] != r->Delta[i] ) { printf("nan in Delta!!!!\n"); return true; }
+     for (int i = 0; i < N; i++) if ( r->Delta[i] != r->Delta[i] ) { printf("nan in Delta!!!!\n"); writer->Flush(); return true; }
 
      // clip off
      bool ClippingDelta= false;
@@ -209,10 +384,19 @@ bool Loop::Run(Result* r)
          else conv = 1;
      }
      if (conv==1) { converged = true; break; }
+
+     if ( (CheckpointEvery > 0) and (it % CheckpointEvery == 0) ) 
+       SaveCheckpoint(it+1, BroydenStatus, &mixer, &B);
   }
   //-----------------------------------//
   
   if (BroydenStatus == 1) B.TurnOff();
+  writer->Flush();
+
+  //a converged run is not resumed again, e.g. by the next point of a sweep.
+  //without checkpointing a file of that name is not ours
+  if ( (converged) and ( (CheckpointEvery > 0) or (Resume) ) and (remove(CheckpointFN.c_str()) == 0) )
+    printf("-- INFO -- Loop: run converged, checkpoint %s removed\n", CheckpointFN.c_str());
   return !converged;
 }
 
@@ -1,7 +1,13 @@
 #include <iostream>
+#include <complex>
+#include <cstdio>
 
 class Result;
 class GRID;
+class AsyncWriter;
+class HistoryArchive;
+class Broyden;
+template <class T> class Mixer;
 
 using namespace std;
 
@@ -33,11 +39,30 @@ class Loop
     bool PrintIntermediate;
     bool HaltOnIterations;
     bool ForceSymmetry;
+    AsyncWriter* writer;	//dumps of intermediate results are written in background
+    bool AsyncOutput;
+    int OutputQueueDepth;
+    HistoryArchive* history;	//compressed Delta, Sigma and G of every iteration
+    bool ArchiveHistory;
+    string HistoryFN;
+    int HistoryKeyframeEvery;
+
+    //---- Checkpoint/restart ----//
+    int CheckpointEvery;	//iterations between checkpoints, 0 - no checkpoints
+    string CheckpointFN;
+    bool Resume;		//continue from CheckpointFN if it exists and belongs to this run
+    unsigned long long ParamsHash;	//params the loop was made with, restart options left out
+    static unsigned long long Hash(const void* data, size_t size, unsigned long long hash = 14695981039346656037ULL);	//FNV-1a
+    virtual unsigned long long get_RunHash();	//identifies the run a checkpoint belongs to
+    bool SaveCheckpoint(int it, int BroydenStatus, Mixer< complex<double> >* mixer, Broyden* B);
+    bool LoadCheckpoint(int &it, int &BroydenStatus, Mixer< complex<double> >* mixer, Broyden* B);
     
     
     //---- Functions to be overridden---//
     virtual bool SolveSIAM();
     virtual void CalcDelta();
+    virtual void SaveState(FILE* f);	//state of derived loops that is carried between iterations
+    virtual bool LoadState(FILE* f);
 
     virtual void ReleaseMemory();
 
@@ -53,4 +78,7 @@ class Loop
     void SetBroydenOptions(bool UseBroyden, bool ForceBroyden, double BroydenStartDiff);
     void SetLoopOptions(int MAX_ITS, double Accr);
     void SetPrintOutOptions(bool PrintIntermediate, bool HaltOnIterations);
+    void SetOutputOptions(bool AsyncOutput, int OutputQueueDepth);
+    void SetHistoryOptions(bool ArchiveHistory, const char* HistoryFN, int HistoryKeyframeEvery);
+    void SetCheckpointOptions(int CheckpointEvery, const char* CheckpointFN, bool Resume);
 };
@@ -0,0 +1,51 @@
+#include <cstdio>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "MappedFile.h"
+
+MappedFile::MappedFile()
+{
+  fd = -1;
+  data = NULL;
+  size = 0;
+}
+
+MappedFile::~MappedFile()
+{
+  Close();
+}
+
+bool MappedFile::Open(const char* FN)
+{
+  Close();
+
+  fd = open(FN, O_RDONLY);
+  if (fd == -1) return false;
+
+  struct stat st;
+  if ( (fstat(fd, &st) == -1) or (st.st_size == 0) )
+  { Close();
+    return false;
+  }
+  size = st.st_size;
+
+  void* p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (p == MAP_FAILED)
+  { Close();
+    return false;
+  }
+  data = (char*) p;
+  madvise(p, size, MADV_SEQUENTIAL);
+  return true;
+}
+
+void MappedFile::Close()
+{
+  if (data != NULL) munmap(data, size);
+  if (fd != -1) close(fd);
+  fd = -1;
+  data = NULL;
+  size = 0;
+}
@@ -0,0 +1,29 @@
+//*************************************************//
+//    Read-only memory mapped file                 //
+//*************************************************//
+
+#ifndef MAPPEDFILE_H
+#define MAPPEDFILE_H
+
+#include <cstddef>
+
+class MappedFile
+{
+  private:
+    int fd;
+    char* data;
+    size_t size;
+
+  public:
+    MappedFile();
+    ~MappedFile();
+
+    bool Open(const char* FN);	//returns false if the file can not be opened or mapped
+    void Close();
+
+    bool IsOpen() { return data != NULL; };
+    const char* get_data() { return data; };
+    size_t get_size() { return size; };
+};
+
+#endif
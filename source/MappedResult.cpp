@@ -0,0 +1,125 @@
+#include <cstdio>
+#include <cstring>
+#include "MappedResult.h"
+#include "Result.h"
+#include "GRID.h"
+
+MappedResult::MappedResult()
+{
+  header = NULL;
+}
+
+MappedResult::MappedResult(const char* ResultFN)
+{
+  header = NULL;
+  Open(ResultFN);
+}
+
+MappedResult::~MappedResult()
+{
+  Close();
+}
+
+bool MappedResult::IsBinary(const char* ResultFN)
+{
+  FILE* f = fopen(ResultFN, "rb");
+  if (f == NULL) return false;
+  char magic[8];
+  bool Binary = (fread(magic, 1, 8, f) == 8) and (memcmp(magic, ResultFile::Magic, 8) == 0);
+  fclose(f);
+  return Binary;
+}
+
+const double* MappedResult::Block(int b)
+{
+  return (const double*) (file.get_data() + header->offset[b]);
+}
+
+bool MappedResult::Open(const char* ResultFN)
+{
+  Close();
+  if (!file.Open(ResultFN)) 
+  { printf("-- ERROR -- MappedResult: can not map %s\n", ResultFN);
+    return false;
+  }
+
+  const ResultFileHeader* h = (const ResultFileHeader*) file.get_data();
+  if ( (file.get_size() < (size_t) ResultFile::HeaderSize) 
+       or (memcmp(h->magic, ResultFile::Magic, 8) != 0) 
+       or (h->version != ResultFile::Version) 
+       or (h->Nblocks != ResultBlocks::Nblocks) )
+  { printf("-- ERROR -- MappedResult: %s is not a binary result file of version %d\n", ResultFN, ResultFile::Version);
+    file.Close();
+    return false;
+  }
+  bool Truncated = (h->TextOffset + h->TextSize > (long long) file.get_size());
+  for (int b=0; b<ResultBlocks::Nblocks; b++)
+    if ( h->offset[b] + (long long) h->width[b] * h->N * (long long) sizeof(double) > (long long) file.get_size() )
+      Truncated = true;
+  if (Truncated)
+  { printf("-- ERROR -- MappedResult: %s is truncated\n", ResultFN);
+    file.Close();
+    return false;
+  }
+  header = h;
+
+  omega = Block(ResultBlocks::omega);
+  fermi = Block(ResultBlocks::fermi);
+  Delta = (const complex<double>*) Block(ResultBlocks::Delta);
+  G0 = (const complex<double>*) Block(ResultBlocks::G0);
+  Ap = Block(ResultBlocks::Ap);
+  Am = Block(ResultBlocks::Am);
+  P1 = Block(ResultBlocks::P1);
+  P2 = Block(ResultBlocks::P2);
+  SOCSigma = (const complex<double>*) Block(ResultBlocks::SOCSigma);
+  Sigma = (const complex<double>*) Block(ResultBlocks::Sigma);
+  G = (const complex<double>*) Block(ResultBlocks::G);
+  DOS = Block(ResultBlocks::DOS);
+  NIDOS = Block(ResultBlocks::NIDOS);
+  DOSmed = Block(ResultBlocks::DOSmed);
+  return true;
+}
+
+void MappedResult::Close()
+{
+  file.Close();
+  header = NULL;
+}
+
+string MappedResult::get_Header()
+{
+  return string(file.get_data() + header->TextOffset, header->TextSize);
+}
+
+bool MappedResult::CopyTo(Result* r)
+{
+  GRID* grid = r->grid;
+  int N = grid->get_N();
+  if ( (header == NULL) or (header->N != N) )
+  { printf("-- ERROR -- MappedResult: grid size does not match\n");
+    return false;
+  }
+  //same N on another grid would be copied silently otherwise
+  if ( (header->GridType != grid->get_GridType()) or (header->Nlog != grid->get_Nlog()) 
+       or (header->Nlin != grid->get_Nlin()) or (header->omega_lin_max != grid->get_omega_lin_max())
+       or (header->omega_max != grid->get_omega_max()) or (header->omega_min != grid->get_omega_min())
+       or (header->domega_min != grid->get_domega_min()) or (header->domega_max != grid->get_domega_max()) )
+  { printf("-- ERROR -- MappedResult: grid definition does not match\n");
+    return false;
+  }
+  //the arrays of r are ResultArrays::Width doubles per point, the file must agree before anything is copied
+  for (int b=0; b<ResultBlocks::Nblocks; b++)
+    if (header->width[b] != ResultArrays::Width[b])
+    { printf("-- ERROR -- MappedResult: block %d has width %d, expected %d\n", b, header->width[b], ResultArrays::Width[b]);
+      return false;
+    }
+  void* to[ResultBlocks::Nblocks];
+  r->get_Blocks(to);
+  for (int b=0; b<ResultBlocks::Nblocks; b++)
+    if (to[b] != NULL) 
+      memcpy(to[b], Block(b), header->width[b] * N * sizeof(double));
+  r->n = header->n;
+  r->mu = header->mu;
+  r->mu0 = header->mu0;
+  return true;
+}
@@ -0,0 +1,117 @@
+//*************************************************//
+//    Binary Result files                          //
+//*************************************************//
+
+// A binary result file starts with a ResultFileHeader of HeaderSize bytes, followed by
+// one block per array and the free text Result::Header. Blocks start at 64 byte aligned
+// offsets, complex arrays are stored as interleaved real and imaginary parts. Numbers are
+// in native byte order.
+
+#include <complex>
+#include <string>
+#include "MappedFile.h"
+
+using namespace std;
+
+class Result;
+
+namespace ResultBlocks
+{
+  const int omega = 0;
+  const int fermi = 1;
+  const int Delta = 2;
+  const int G0 = 3;
+  const int Ap = 4;
+  const int Am = 5;
+  const int P1 = 6;
+  const int P2 = 7;
+  const int SOCSigma = 8;
+  const int Sigma = 9;
+  const int G = 10;
+  const int DOS = 11;
+  const int NIDOS = 12;
+  const int DOSmed = 13;
+  const int Nblocks = 14;
+}
+
+namespace ResultFile
+{
+  const char Magic[8] = {'D','M','F','T','R','E','S','B'};
+  const int Version = 2;
+  const int HeaderSize = 320;
+  const int Alignment = 64;
+}
+
+struct ResultFileHeader
+{
+  char magic[8];
+  int version;
+  int N;
+  double n;
+  double mu;
+  double mu0;
+
+  //grid definition
+  int GridType;
+  int Nlog;
+  int Nlin;
+  int Nblocks;
+  double omega_lin_max;
+  double omega_max;
+  double omega_min;
+  double domega_min;
+  double domega_max;
+
+  int width[ResultBlocks::Nblocks];		//doubles per grid point: 1 for real, 2 for complex arrays
+  long long offset[ResultBlocks::Nblocks];	//from the start of the file
+
+  long long TextOffset;				//Result::Header, not 0 terminated
+  long long TextSize;
+};
+
+typedef char ResultFileHeaderFits[ (sizeof(ResultFileHeader) <= ResultFile::HeaderSize) ? 1 : -1 ];
+
+class MappedResult
+{
+  private:
+    MappedFile file;
+    const ResultFileHeader* header;
+    const double* Block(int b);
+
+  public:
+    MappedResult();
+    MappedResult(const char* ResultFN);
+    ~MappedResult();
+
+    bool Open(const char* ResultFN);	//returns false if the file is not a valid binary result
+    void Close();
+    bool IsOpen() { return header != NULL; };
+
+    static bool IsBinary(const char* ResultFN);
+
+    const ResultFileHeader* get_header() { return header; };
+    int get_N() { return header->N; };
+    double get_n() { return header->n; };
+    double get_mu() { return header->mu; };
+    double get_mu0() { return header->mu0; };
+    string get_Header();
+
+    //arrays point directly into the mapped file and are valid until Close
+    const double* omega;
+    const double* fermi;
+    const double* Ap;
+    const double* Am;
+    const double* P1;
+    const double* P2;
+    const complex<double>* SOCSigma;
+    const complex<double>* Sigma;
+    const complex<double>* G;
+    const complex<double>* Delta;
+    const complex<double>* G0;
+    const double* DOS;
+    const double* NIDOS;
+    const double* DOSmed;
+
+    //bulk copy into a result on the same grid, returns false if the grid or a block width differs
+    bool CopyTo(Result* r);
+};
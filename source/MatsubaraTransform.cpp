@@ -0,0 +1,176 @@
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+#include "MatsubaraTransform.h"
+#include "GRID.h"
+#include "routines.h"
+
+MatsubaraTransform::MatsubaraTransform()
+{
+  grid = NULL;
+  omega = NULL;
+  N = 0;
+  T = 0.0;
+  W = 0.0;
+  Mkernel = 0;
+  Mcached = 0;
+  kernel = NULL;
+  Nf = 0;
+  moments = NULL;
+  Finf = NULL;
+}
+
+MatsubaraTransform::~MatsubaraTransform()
+{
+  delete [] kernel;
+  delete [] moments;
+  delete [] Finf;
+}
+
+double MatsubaraTransform::Frequency(double T, int m)
+{
+  return 2.0*pi*T*(m+0.5);
+}
+
+//------------------------ kernel ---------------------------//
+
+void MatsubaraTransform::get_Row(int m, double* row)
+{
+  double nu2 = sqr(Frequency(T, m));
+  const double* w = grid->get_weights();
+  #pragma omp simd
+  for (int i=0; i<N; i++)
+    row[i] = w[i] / (omega[i]*omega[i] + nu2);
+}
+
+void MatsubaraTransform::Prepare(GRID* grid, double* omega, double T, int M)
+{
+  int N = grid->get_N();
+  double W = max(abs(omega[0]), abs(omega[N-1]));
+  int Mtail = (int) ceil( MatsubaraTail::TailStart * W / (2.0*pi*T) - 0.5 );
+  int Mkernel = min(M, max(Mtail, 0));
+  int Mcached = (int) min( (long) Mkernel, MatsubaraTail::MaxKernel / N );
+
+  if ( (grid == this->grid) and (omega == this->omega) and (N == this->N) and (T == this->T)
+       and (W == this->W) and (Mcached <= this->Mcached) )
+  { this->Mkernel = Mkernel;
+    return;
+  }
+
+  this->grid = grid;
+  this->omega = omega;
+  this->N = N;
+  this->T = T;
+  this->W = W;
+  this->Mkernel = Mkernel;
+  this->Mcached = Mcached;
+  delete [] kernel;
+  kernel = (Mcached > 0) ? new double[(long) Mcached * N] : NULL;
+  #pragma omp parallel for schedule(static)
+  for (int m=0; m<Mcached; m++)
+    get_Row(m, kernel + (long) m * N);
+  printf("-- INFO -- MatsubaraTransform: kernel of %d x %d at T = %.4f, %d frequencies below the tail\n",
+         Mcached, N, T, Mkernel);
+}
+
+//------------------------ transform ---------------------------//
+
+void MatsubaraTransform::Transform(GRID* grid, double* omega, double T, int M,
+                                   int Nf, complex<double>** F, const double* Finf, complex<double>** F_out)
+{
+  Prepare(grid, omega, T, M);
+
+  if (Nf != this->Nf)
+  { delete [] moments;
+    delete [] this->Finf;
+    this->Nf = Nf;
+    moments = new double[Nf * MatsubaraTail::Nmoments];
+    this->Finf = new double[Nf];
+  }
+  for (int f=0; f<Nf; f++) this->Finf[f] = (Finf != NULL) ? Finf[f] : 0.0;
+
+  //A and omega*A of every function
+  double* a = new double[2L * Nf * N];
+  #pragma omp parallel for schedule(static)
+  for (int i=0; i<N; i++)
+    for (int f=0; f<Nf; f++)
+    { a[2L*f*N + i] = - imag(F[f][i]) / pi;
+      a[(2L*f+1)*N + i] = omega[i] * a[2L*f*N + i];
+    }
+
+  //moments in units of W^k
+  double* p = new double[N];
+  for (int f=0; f<Nf; f++)
+  { for (int i=0; i<N; i++) p[i] = a[2L*f*N + i];
+    for (int k=0; k<MatsubaraTail::Nmoments; k++)
+    { moments[f*MatsubaraTail::Nmoments + k] = WeightedSum(N, grid->get_weights(), p);
+      for (int i=0; i<N; i++) p[i] *= omega[i] / W;
+    }
+  }
+  delete [] p;
+
+  //low frequencies: each kernel row is read once for all functions
+  #pragma omp parallel
+  {
+    double* row = (Mkernel > Mcached) ? new double[N] : NULL;
+    #pragma omp for schedule(static)
+    for (int m=0; m<Mkernel; m++)
+    { const double* D = kernel + (long) m * N;
+      if (m >= Mcached)
+      { get_Row(m, row);
+        D = row;
+      }
+      double nu = Frequency(T, m);
+      for (int f=0; f<Nf; f++)
+      { const double* A = a + 2L*f*N;
+        const double* B = A + N;
+        double re = 0.0, im = 0.0;
+        #pragma omp simd reduction(+:re,im)
+        for (int i=0; i<N; i++)
+        { re += D[i] * B[i];
+          im += D[i] * A[i];
+        }
+        F_out[f][m] = complex<double>(this->Finf[f] - re, - nu * im);
+      }
+    }
+    delete [] row;
+  }
+
+  //tail: sum_k c_k / (i nu)^(k+1), by Horner in W / (i nu)
+  #pragma omp parallel for schedule(static)
+  for (int m=Mkernel; m<M; m++)
+  { complex<double> z(0.0, Frequency(T, m));
+    complex<double> u = W / z;
+    for (int f=0; f<Nf; f++)
+    { const double* c = moments + f*MatsubaraTail::Nmoments;
+      complex<double> s = 0.0;
+      for (int k=MatsubaraTail::Nmoments-1; k>=0; k--)
+        s = s * u + c[k];
+      F_out[f][m] = this->Finf[f] + s / z;
+    }
+  }
+
+  delete [] a;
+}
+
+//------------------------ tail ---------------------------//
+
+double MatsubaraTransform::get_Moment(int f, int k)
+{
+  return moments[f*MatsubaraTail::Nmoments + k] * pow(W, k);
+}
+
+double MatsubaraTransform::MatsubaraSum(int f, int M, const complex<double>* Fm)
+{ //F - c0/(i nu) - c1/(i nu)^2 - c2/(i nu)^3 decays as nu^-4, the subtracted terms are summed
+  //exactly: T sum e^(i nu 0+)/(i nu) = 1/2, T sum 1/(i nu)^2 = -1/(4T), T sum 1/(i nu)^3 = 0
+  double c0 = get_Moment(f, 0);
+  double c1 = get_Moment(f, 1);
+  double c2 = get_Moment(f, 2);
+  double sum = 0.0;
+  for (int m=0; m<M; m++)
+  { complex<double> z(0.0, Frequency(T, m));
+    complex<double> R = Fm[m] - Finf[f] - c0/z - c1/(z*z) - c2/(z*z*z);
+    sum += real(R);
+  }
+  return 2*T*sum + 0.5*c0 - c1/(4*T);
+}
@@ -0,0 +1,57 @@
+//*************************************************//
+//    Real axis to Matsubara axis transform        //
+//*************************************************//
+
+// F(i nu_m) = F_inf + int domega A(omega) / (i nu_m - omega), A = -Im F / pi, for several
+// functions at once. The kernel w_i / (omega_i^2 + nu_m^2) of the grid quadrature is kept
+// between calls at the same T and grid. Above nu = TailStart * max|omega| the transform is
+// summed from the moments of A, G = sum_k c_k / (i nu)^(k+1), which is the same quadrature
+// expanded, so the kernel only covers the low frequencies. The low moments also give the
+// high frequency tail of Matsubara sums, so that few frequencies are enough.
+
+#include <complex>
+
+class GRID;
+
+using namespace std;
+
+namespace MatsubaraTail
+{
+  const int Nmoments = 24;	//series error ~ TailStart^-(Nmoments+1)
+  const double TailStart = 4.0;
+  const long MaxKernel = 1L << 24;	//doubles kept, rows beyond are computed on the fly
+}
+
+class MatsubaraTransform
+{
+  private:
+    GRID* grid;
+    double* omega;
+    int N;
+    double T;
+    double W;		//max |omega|
+    int Mkernel;	//frequencies below the tail
+    int Mcached;	//rows of the kernel kept
+    double* kernel;	//Mcached rows of N
+
+    int Nf;
+    double* moments;	//Nf rows of Nmoments, moment k in units of W^k
+    double* Finf;
+
+    void Prepare(GRID* grid, double* omega, double T, int M);
+    void get_Row(int m, double* row);
+
+  public:
+    MatsubaraTransform();
+    ~MatsubaraTransform();
+
+    static double Frequency(double T, int m);
+
+    //F are Nf retarded functions on the grid, Finf their constant parts (NULL for none),
+    //F_out Nf arrays of M values at nu_0 ... nu_(M-1)
+    void Transform(GRID* grid, double* omega, double T, int M,
+                   int Nf, complex<double>** F, const double* Finf, complex<double>** F_out);
+
+    double get_Moment(int f, int k);	//int omega^k A_f(omega), from the last Transform
+    double MatsubaraSum(int f, int M, const complex<double>* Fm);	//T sum_m (F(i nu_m)-F_inf) e^(i nu_m 0+), with the tail
+};
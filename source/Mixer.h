@@ -1,4 +1,5 @@
 #include "routines.h" 
+#include <cstdio>
 
 template <class T> //T may be  float, double, complex<double>
 class Mixer
@@ -32,6 +33,10 @@ class Mixer
      //initializes Mixer for M N-long Solutions that will be mixed with Coefs until Accr reached
     void Initialize(int N, int M, const int * Coefs, double Accr);
     void Reset();
+
+    //------ checkpointing: saved solutions and counters, Coefs are not saved ----//
+    void Save(FILE* f);
+    bool Load(FILE* f); //returns false if the saved mixer does not match this one
 };
 
 template <class T>
@@ -81,6 +86,32 @@ void Mixer<T>::Reset()
   Initialize(N,M,Coefs,Accr);
 }
 
+template <class T>
+void Mixer<T>::Save(FILE* f)
+{
+  fwrite(&N, sizeof(int), 1, f);
+  fwrite(&M, sizeof(int), 1, f);
+  fwrite(&Counter, sizeof(int), 1, f);
+  fwrite(&CurrentDiff, sizeof(double), 1, f);
+  for (int n=0; n<M; n++) fwrite(X[n], sizeof(T), N, f);
+}
+
+template <class T>
+bool Mixer<T>::Load(FILE* f)
+{
+  int N, M;
+  if ( (fread(&N, sizeof(int), 1, f) != 1) or (fread(&M, sizeof(int), 1, f) != 1) ) return false;
+  if ( (!Initialized) or (N != this->N) or (M != this->M) ) 
+  { printf("----Mixer: ERROR: saved mixer does not match !!!\n");
+    return false;
+  }
+  bool ok = (fread(&Counter, sizeof(int), 1, f) == 1) 
+            and (fread(&CurrentDiff, sizeof(double), 1, f) == 1);
+  for (int n=0; n<M; n++) 
+    ok = ok and (fread(X[n], sizeof(T), N, f) == (size_t) N);
+  return ok;
+}
+
 template <class T>
 void Mixer<T>::AddSolution(T* Solution)
 {
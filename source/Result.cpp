@@ -1,182 +1,364 @@
 #include "Result.h"
 #include "GRID.h"
+#include "MappedResult.h"
+#include "TextWriter.h"
+#include "TextReader.h"
+#include <cstdio>
+#include <cstring>
+#include <cstdlib>
 
-Result::Result(GRID* grid)
+int Result::FirstTouch = FirstTouchPolicies::Static;
+
+Result::Result(GRID* grid, int Arrays)
 {
-  Initialize(grid);
+  Initialize(grid, Arrays);
 }
 
 Result::Result(const Result &result)
 {
-  Initialize(result.grid);
+  Initialize(result.grid, result.Arrays);
   CopyFrom(result);
 }
 
+Result::Result(Result &&result)
+{
+  Initialize(result.grid, 0);
+  Swap(result);
+}
+
 Result::~Result()
 {
   ReleaseMemory();
 }
 
+Result& Result::operator=(const Result &result)
+{
+  if (this != &result) CopyFrom(result);
+  return *this;
+}
+
+Result& Result::operator=(Result &&result)
+{
+  if (this != &result) Swap(result);	//result takes over the old arrays and frees them
+  return *this;
+}
+
+void Result::Swap(Result &result)
+{
+  swap(grid, result.grid);
+  swap(Arrays, result.Arrays);
+  swap(slab, result.slab);
+  swap(n, result.n);
+  swap(mu, result.mu);
+  swap(mu0, result.mu0);
+  Header.swap(result.Header);
+  swap(omega, result.omega);
+  swap(fermi, result.fermi);
+  swap(Delta, result.Delta);
+  swap(G0, result.G0);
+  swap(Ap, result.Ap);
+  swap(Am, result.Am);
+  swap(P1, result.P1);
+  swap(P2, result.P2);
+  swap(SOCSigma, result.SOCSigma);
+  swap(Sigma, result.Sigma);
+  swap(G, result.G);
+  swap(DOS, result.DOS);
+  swap(NIDOS, result.NIDOS);
+  swap(DOSmed, result.DOSmed);
+}
+
 void Result::Reset()
 {
   ReleaseMemory();
-  Initialize(grid);
+  Initialize(grid, Arrays);
 }
 
 void Result::Reset(GRID* grid)
 {
   ReleaseMemory();
-  Initialize(grid);
+  Initialize(grid, Arrays);
 }
 
-void Result::Initialize(GRID* grid)
+void Result::Initialize(GRID* grid, int Arrays)
 {
   this->grid = grid;
+  this->Arrays = Arrays;
   
-  int N = grid->get_N();
+  int N = (Arrays == 0) ? 0 : grid->get_N();
+
+  //offsets of the arrays in the slab
+  size_t offset[ResultArrays::Nblocks];
+  size_t size = 0;
+  for (int b=0; b<ResultArrays::Nblocks; b++)
+  { offset[b] = size;
+    if (Arrays & (1 << b))
+      size += ( (ResultArrays::Width[b] * N * sizeof(double) + Alignment - 1) / Alignment + 1 ) * Alignment;
+  }
+  slab = NULL;
+  if ( (size > 0) and (posix_memalign((void**) &slab, 4096, size) != 0) )
+  { printf("-- ERROR -- Result: can not allocate %lu bytes\n", (unsigned long) size);
+    exit(1);
+  }
+
+  double* blocks[ResultArrays::Nblocks];
+  for (int b=0; b<ResultArrays::Nblocks; b++)
+    blocks[b] = (Arrays & (1 << b)) ? (double*) (slab + offset[b]) : NULL;
   
-  omega = new double[N];
-  grid->assign_omega(omega);
-
-  Delta = new complex<double>[N];
-  fermi = new double[N];
-  G0 = new complex<double>[N];
-  Ap = new double[N];
-  Am = new double[N];
-  P1 = new double[N];
-  P2 = new double[N];
-  SOCSigma = new complex<double>[N];
-  Sigma = new complex<double>[N];
-  G = new complex<double>[N];
-  DOS = new double[N];
-  NIDOS = new double[N];
-  DOSmed = new double[N];
+  omega = blocks[0];
+  fermi = blocks[1];
+  Delta = (complex<double>*) blocks[2];
+  G0 = (complex<double>*) blocks[3];
+  Ap = blocks[4];
+  Am = blocks[5];
+  P1 = blocks[6];
+  P2 = blocks[7];
+  SOCSigma = (complex<double>*) blocks[8];
+  Sigma = (complex<double>*) blocks[9];
+  G = (complex<double>*) blocks[10];
+  DOS = blocks[11];
+  NIDOS = blocks[12];
+  DOSmed = blocks[13];
+
+  Touch(N);
+  if (omega != NULL) grid->assign_omega(omega);
 
   n=0.0;
   mu=0.0;
   mu0=0.0;
 }
 
+void Result::Touch(int N)
+{ //the first write to a page decides its NUMA node
+  double* blocks[ResultArrays::Nblocks];
+  get_Blocks((void**) blocks);
+  if (FirstTouch == FirstTouchPolicies::Static)
+  { 
+    #pragma omp parallel for schedule(static)
+    for (int i=0; i<N; i++)
+      for (int b=0; b<ResultArrays::Nblocks; b++)
+        if (blocks[b] != NULL)
+          for (int k=0; k<ResultArrays::Width[b]; k++) blocks[b][i*ResultArrays::Width[b] + k] = 0;
+  }
+  else
+    for (int b=0; b<ResultArrays::Nblocks; b++)
+      if (blocks[b] != NULL) memset(blocks[b], 0, ResultArrays::Width[b] * N * sizeof(double));
+}
+
 void Result::ReleaseMemory()
 {
-  delete [] omega;
+  free(slab);
+  slab = NULL;
+}
 
-  delete [] Delta;
-  delete [] fermi;          
-  delete [] G0;  
-  delete [] Ap;          
-  delete [] Am;
-  delete [] P1;         
-  delete [] P2;
-  delete [] SOCSigma;
-  delete [] Sigma;
-  delete [] G;
-  delete [] DOS;
-  delete [] NIDOS;
-  delete [] DOSmed;
+void Result::get_Blocks(void** blocks) const
+{
+  blocks[0] = omega;
+  blocks[1] = fermi;
+  blocks[2] = Delta;
+  blocks[3] = G0;
+  blocks[4] = Ap;
+  blocks[5] = Am;
+  blocks[6] = P1;
+  blocks[7] = P2;
+  blocks[8] = SOCSigma;
+  blocks[9] = Sigma;
+  blocks[10] = G;
+  blocks[11] = DOS;
+  blocks[12] = NIDOS;
+  blocks[13] = DOSmed;
 }
 
-void Result::PrintResult(const char* ResultFN)
+bool Result::PrintResult(const char* ResultFN, int Format)
 { 
-  FILE *f;
-  f = fopen(ResultFN, "w+");
-  
-  fprintf(f,"# n = %le mu = %le mu0=%le\n",n,mu,mu0);   
+  if (Format == ResultFormats::Binary)
+    return PrintBinary(ResultFN);
+
+  TextWriter f(ResultFN);
+  if (!f.IsOpen()) return false;
+
+  char header[200];
+  snprintf(header, 200, "# n = %le mu = %le mu0=%le\n",n,mu,mu0);
+  f.Put(header);
+  for (size_t a=0; a<Header.size(); )
+  { size_t b = Header.find('\n', a);
+    if (b == string::npos) b = Header.size();
+    f.Put("# ");
+    f.Put(Header.substr(a, b-a).c_str());
+    f.Put('\n');
+    a = b+1;
+  }
 
   int N = grid->get_N();
-  int i;
-  for (i=0; i<N; i++)
-  { 
-     // loop through and store the numbers into the file
-    fprintf(f, "%.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le\n", 
-                   omega[i], fermi[i],					//1 2
-                   real(Delta[i]), imag(Delta[i]),			//3 4
-                   real(G0[i]), imag(G0[i]), 				//5 6
-                   Ap[i], Am[i], P1[i], P2[i],				//7 8 9 10 
-                   real(SOCSigma[i]), imag(SOCSigma[i]), 		//11 12
-                   real(Sigma[i]), imag(Sigma[i]),			//13 14
-                   real(G[i]), imag(G[i]),				//15 16
-                   DOS[i], NIDOS[i], DOSmed[i]);			//17 18 19 
-                   
-                
+  const double* blocks[ResultArrays::Nblocks];
+  get_Blocks((void**) blocks);
+  for (int i=0; i<N; i++)
+  { //1 omega, 2 fermi, 3 4 Delta, 5 6 G0, 7 Ap, 8 Am, 9 P1, 10 P2, 11 12 SOCSigma, 
+    //13 14 Sigma, 15 16 G, 17 DOS, 18 NIDOS, 19 DOSmed. Arrays not allocated are printed as 0
+    for (int b=0; b<ResultArrays::Nblocks; b++)
+      for (int k=0; k<ResultArrays::Width[b]; k++)
+      { if (b+k>0) f.Put(' ');
+        f.Put( (blocks[b] != NULL) ? blocks[b][i*ResultArrays::Width[b] + k] : 0.0 );
+      }
+    f.Put('\n');
   }
-  fclose(f);
+  return true;
+}
+
+bool Result::PrintBinary(const char* ResultFN)
+{
+  int N = grid->get_N();
+
+  const void* blocks[ResultBlocks::Nblocks];
+  get_Blocks((void**) blocks);
+  const int* widths = ResultArrays::Width;
+
+  ResultFileHeader h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, ResultFile::Magic, 8);
+  h.version = ResultFile::Version;
+  h.N = N;
+  h.n = n;
+  h.mu = mu;
+  h.mu0 = mu0;
+  h.GridType = grid->get_GridType();
+  h.Nlog = grid->get_Nlog();
+  h.Nlin = grid->get_Nlin();
+  h.Nblocks = ResultBlocks::Nblocks;
+  h.omega_lin_max = grid->get_omega_lin_max();
+  h.omega_max = grid->get_omega_max();
+  h.omega_min = grid->get_omega_min();
+  h.domega_min = grid->get_domega_min();
+  h.domega_max = grid->get_domega_max();
+
+  long long offset = ResultFile::HeaderSize;
+  for (int b=0; b<ResultBlocks::Nblocks; b++)
+  { h.width[b] = widths[b];
+    h.offset[b] = offset;
+    long long size = (long long) widths[b] * N * sizeof(double);
+    offset += ( (size + ResultFile::Alignment - 1) / ResultFile::Alignment ) * ResultFile::Alignment;
+  }
+  h.TextOffset = offset;
+  h.TextSize = Header.size();
+
+  FILE *f;
+  f = fopen(ResultFN, "wb");
+  if (f == NULL)
+  { printf("-- ERROR -- Result: can not open %s for writing\n", ResultFN);
+    return false;
+  }
+
+  char pad[ResultFile::HeaderSize];
+  memset(pad, 0, ResultFile::HeaderSize);
+  memcpy(pad, &h, sizeof(h));
+  bool ok = (fwrite(pad, 1, ResultFile::HeaderSize, f) == (size_t) ResultFile::HeaderSize);
+  memset(pad, 0, ResultFile::Alignment);
+  double* zeros = NULL;		//for arrays that are not allocated
+  for (int b=0; b<ResultBlocks::Nblocks; b++)
+  { long long size = (long long) widths[b] * N * sizeof(double);
+    if ( (blocks[b] == NULL) and (zeros == NULL) ) zeros = new double[2*N]();
+    ok = ok and (fwrite((blocks[b] != NULL) ? blocks[b] : zeros, 1, size, f) == (size_t) size);
+    long long next = (b+1 < ResultBlocks::Nblocks) ? h.offset[b+1] : h.TextOffset;
+    ok = ok and (fwrite(pad, 1, next - h.offset[b] - size, f) == (size_t) (next - h.offset[b] - size));
+  }
+  ok = ok and (fwrite(Header.data(), 1, Header.size(), f) == Header.size());
+  delete [] zeros;
+  ok = (fclose(f) == 0) and ok;
+  if (!ok) printf("-- ERROR -- Result: could not write %s\n", ResultFN);
+  return ok;
 }
 
 void Result::ReadFromFile(const char* ResultFN)
 { 
-  FILE *f;
-  f = fopen(ResultFN, "r");
+  if (MappedResult::IsBinary(ResultFN))
+  { MappedResult m;
+    if (m.Open(ResultFN)) m.CopyTo(this);
+    return;
+  }
 
-  char rstLine[1000];
-  fgets ( rstLine, 1000, f );
+  TextReader f(ResultFN);
+  if (!f.IsOpen())
+  { printf("-- ERROR -- Result: can not read %s\n", ResultFN);
+    return;
+  }
+  //n, mu, mu0 line and Header
+  while ( (!f.AtEnd()) and (f.Peek() == '#') ) f.SkipLine();
+
+  int N = grid->get_N();
+  double* blocks[ResultArrays::Nblocks];
+  get_Blocks((void**) blocks);
+  for (int i=0; i<N; i++)
+    for (int b=0; b<ResultArrays::Nblocks; b++)
+      for (int k=0; k<ResultArrays::Width[b]; k++)
+      { double x;
+        if (!f.Read(x)) x = 0;
+        if (blocks[b] != NULL) blocks[b][i*ResultArrays::Width[b] + k] = x;
+      }
+}
 
+void Result::Save(FILE* f)
+{ //arrays that are not allocated are saved as 0
   int N = grid->get_N();
-  int i;
-  for (i=0; i<N; i++)
-  { double o, fer, rd, id, rg0, ig0, ap, am, p1, p2, rsocs, isocs, rs, is, rg, ig, dos, nidos, dosmed;
-     // loop through and store the numbers into the file
-    fscanf(f, "%le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le %le\n", 
-                   &o, &fer,			//1 2
-                   &rd, &id,			//3 4
-                   &rg0, &ig0, 			//5 6
-                   &ap, &am, &p1, &p2,		//7 8 9 10 
-                   &rsocs, &isocs, 		//11 12
-                   &rs, &is,			//13 14
-                   &rg, &ig,			//15 16
-                   &dos, &nidos, &dosmed);	//17 18 19 
-
-   /* printf("%.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le %.15le\n",
-                   o, fer,			//1 2
-                   rd, id,			//3 4
-                   rg0, ig0, 			//5 6
-                   ap, am, p1, p2,		//7 8 9 10 
-                   rsocs, isocs, 		//11 12
-                   rs, is,			//13 14
-                   rg, ig,			//15 16
-                   dos, nidos, dosmed);*/
-    omega[i] = o;
-    fermi[i] = fer;					
-    Delta[i] = complex<double>(rd,id);			
-    G0[i] = complex<double>(rg0,ig0); 				
-    Ap[i] = ap; Am[i]=am; P1[i]=p1; P2[i]=p2;		
-    SOCSigma[i] = complex<double>(rsocs,isocs); 	
-    Sigma[i] = complex<double>(rs,is);			
-    G[i] = complex<double>(rg,ig);			
-    DOS[i] = dos; NIDOS[i] = nidos; DOSmed[i]=dosmed;	                                  
+  fwrite(&N, sizeof(int), 1, f);
+  double scalars[3] = { n, mu, mu0 };
+  fwrite(scalars, sizeof(double), 3, f);
+  const double* blocks[ResultArrays::Nblocks];
+  get_Blocks((void**) blocks);
+  double* zeros = NULL;
+  for (int b=0; b<ResultArrays::Nblocks; b++)
+  { if ( (blocks[b] == NULL) and (zeros == NULL) ) zeros = new double[2*N]();
+    fwrite((blocks[b] != NULL) ? blocks[b] : zeros, sizeof(double), ResultArrays::Width[b]*N, f);
   }
-  fclose(f);
+  delete [] zeros;
 }
 
+bool Result::Load(FILE* f)
+{
+  int N;
+  if ( (fread(&N, sizeof(int), 1, f) != 1) or (N != grid->get_N()) ) return false;
+  double scalars[3];
+  bool ok = (fread(scalars, sizeof(double), 3, f) == 3);
+  double* blocks[ResultArrays::Nblocks];
+  get_Blocks((void**) blocks);
+  for (int b=0; (ok) and (b<ResultArrays::Nblocks); b++)
+  { int size = ResultArrays::Width[b]*N;
+    if (blocks[b] != NULL)
+      ok = (fread(blocks[b], sizeof(double), size, f) == (size_t) size);
+    else
+      ok = (fseek(f, size*sizeof(double), SEEK_CUR) == 0);
+  }
+  n = scalars[0];
+  mu = scalars[1];
+  mu0 = scalars[2];
+  return ok;
+}
 
 void Result::CopyFrom(const Result &result)
 {
-  Reset(result.grid);
+  bool Empty = (Arrays == 0);	//moved from
+  if (Empty) Arrays = result.Arrays;
+  if ( Empty or (grid == NULL) or (grid->get_N() != result.grid->get_N()) ) 
+    Reset(result.grid);
+  grid = result.grid;
 
-  int N = result.grid->get_N();
-
-  for (int i=0; i<N; i++)
-  {
-    //printf("m"); 
-    omega[i] = result.omega[i];
-    Delta[i] = result.Delta[i];
-    fermi[i] = result.fermi[i];
-    G0[i] = result.G0[i];
-    Ap[i] = result.Ap[i];
-    Am[i] = result.Am[i];
-    P1[i] = result.P1[i];
-    P2[i] = result.P2[i];
-    SOCSigma[i] = result.SOCSigma[i];
-    Sigma[i] = result.Sigma[i];
-    G[i] = result.G[i];
-    DOS[i] = result.DOS[i];
-    NIDOS[i] = result.NIDOS[i];
-    DOSmed[i] = result.DOSmed[i];
+  int N = grid->get_N();
+  void* to[ResultArrays::Nblocks];
+  void* from[ResultArrays::Nblocks];
+  get_Blocks(to);
+  result.get_Blocks(from);
+  for (int b=0; b<ResultArrays::Nblocks; b++)
+  { if (to[b] == NULL) continue;
+    size_t size = ResultArrays::Width[b] * N * sizeof(double);
+    if (from[b] != NULL) 
+      memcpy(to[b], from[b], size);
+    else
+      memset(to[b], 0, size);
   }
 
   n = result.n;
   mu = result.mu;
   mu0 = result.mu0;
+  Header = result.Header;
 }
 /*
 void SIAM::PrintModel()
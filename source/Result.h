@@ -1,24 +1,77 @@
 #include <complex>
+#include <string>
+#include <cstdio>
 using namespace std;
 
 class GRID;
 
+namespace ResultFormats
+{
+  const int Text = 0;		//19 columns of %.15le, see PrintResult
+  const int Binary = 1;		//header and aligned column blocks, see MappedResult.h
+}
+
+namespace ResultArrays
+{ //masks of the arrays a Result allocates, bits are in the order of ResultBlocks (MappedResult.h)
+  const int omega = 1 << 0;
+  const int fermi = 1 << 1;
+  const int Delta = 1 << 2;
+  const int G0 = 1 << 3;
+  const int Ap = 1 << 4;
+  const int Am = 1 << 5;
+  const int P1 = 1 << 6;
+  const int P2 = 1 << 7;
+  const int SOCSigma = 1 << 8;
+  const int Sigma = 1 << 9;
+  const int G = 1 << 10;
+  const int DOS = 1 << 11;
+  const int NIDOS = 1 << 12;
+  const int DOSmed = 1 << 13;
+  const int All = (1 << 14) - 1;
+  const int Siam = All & ~(NIDOS | DOSmed);	//arrays used by SIAM::Run, e.g. for TMT impurities
+
+  const int Nblocks = 14;
+  const int Width[Nblocks] = { 1, 1, 2, 2, 1, 1, 1, 1, 2, 2, 2, 1, 1, 1 };	//doubles per grid point
+}
+
+namespace FirstTouchPolicies
+{
+  const int Serial = 0;		//pages are placed on the NUMA node of the allocating thread
+  const int Static = 1;		//pages are placed by the OpenMP static schedule used by the kernels
+}
+
 class Result
 {
   public:
-    Result(GRID* grid);
+    Result(GRID* grid, int Arrays = ResultArrays::All);
     Result(const Result &result);
+    Result(Result &&result);		//takes over the arrays, result is left empty
     ~Result();
 
+    Result& operator=(const Result &result);
+    Result& operator=(Result &&result);
+    void Swap(Result &result);
+
     void Reset();
     void Reset(GRID* grid);
  
     GRID* grid;
+    int Arrays;			//allocated arrays, the others are NULL
+
+    //array pointers in ResultBlocks order, NULL if not allocated
+    void get_Blocks(void** blocks) const;
+
+    //all arrays live in one slab, page aligned, each array 64 byte aligned and followed
+    //by a cache line of padding. Arrays are zeroed on allocation according to FirstTouch.
+    static int FirstTouch;
+    static const int Alignment = 64;
 
     double n;
     double mu;
     double mu0;
 
+    string Header;		//free text printed as '#' comment lines in the text format, e.g. Input::Serialize()
+
     double* omega;		//omega grid
     double* fermi;		//fermi function
     double* Ap;			//spectral functions
@@ -34,11 +87,20 @@ class Result
     double* NIDOS;		//non-interacting density of states
     double* DOSmed;		//medium DOS in TMT, can be used as an auxiallry DOS in other cases
 
-    void PrintResult(const char* ResultFN);
-    void ReadFromFile(const char* ResultFN);
+    bool PrintResult(const char* ResultFN, int Format = ResultFormats::Text);	//false if the file could not be written
+    void ReadFromFile(const char* ResultFN);	//format is detected from the file
+    //arrays allocated here are copied, or zeroed if result does not have them.
+    //No reallocation if the grid size is the same
     void CopyFrom(const Result &result);
 
+    //raw arrays for checkpoints, Load returns false if the grid size does not match
+    void Save(FILE* f);
+    bool Load(FILE* f);
+
   private:
-    void Initialize(GRID* grid);
+    char* slab;
+    void Initialize(GRID* grid, int Arrays);
+    void Touch(int N);
     void ReleaseMemory();
+    bool PrintBinary(const char* ResultFN);
 };
@@ -0,0 +1,156 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <sstream>
+#include <sys/stat.h>
+#include "ResultCache.h"
+#include "Result.h"
+#include "GRID.h"
+#include "MappedResult.h"
+
+ResultCache::ResultCache(const char* Dir)
+{
+  this->Dir.assign(Dir);
+  NumericsHash = FNV1a(NULL, 0);
+  mkdir(Dir, 0755);
+  ReadIndex();
+  printf("-- INFO -- ResultCache: %d results in %s\n", (int) entries.size(), Dir);
+}
+
+unsigned long long ResultCache::FNV1a(const void* data, size_t size, unsigned long long hash)
+{
+  const unsigned char* p = (const unsigned char*) data;
+  for (size_t i=0; i<size; i++)
+  { hash ^= p[i];
+    hash *= 1099511628211ULL;
+  }
+  return hash;
+}
+
+void ResultCache::SetNumerics(GRID* grid, const string &params, int Nexclude, const char** Exclude)
+{
+  //grid definition
+  int ints[4] = { grid->get_GridType(), grid->get_N(), grid->get_Nlog(), grid->get_Nlin() };
+  double doubles[5] = { grid->get_omega_lin_max(), grid->get_omega_max(), grid->get_omega_min(),
+                        grid->get_domega_min(), grid->get_domega_max() };
+  unsigned long long hash = FNV1a(ints, sizeof(ints));
+  hash = FNV1a(doubles, sizeof(doubles), hash);
+
+  //params lines, sorted so that the order in the file does not matter
+  vector<string> lines;
+  istringstream ss(params);
+  string line;
+  while (getline(ss, line))
+  { bool Excluded = false;
+    istringstream ls(line);
+    string token;
+    ls >> token;		//first value
+    while (ls >> token)
+    { for (int i=0; i<Nexclude; i++)
+        if (token == Exclude[i]) Excluded = true;
+      for (int i=0; i<CacheIgnored::N; i++)
+        if (token == CacheIgnored::Names[i]) Excluded = true;
+    }
+    if (!Excluded) lines.push_back(line);
+  }
+  sort(lines.begin(), lines.end());
+  for (size_t i=0; i<lines.size(); i++)
+    hash = FNV1a(lines[i].c_str(), lines[i].size() + 1, hash);
+
+  NumericsHash = hash;
+}
+
+unsigned long long ResultCache::Hash(int Ncoords, const double* coords)
+{
+  return FNV1a(coords, Ncoords*sizeof(double), NumericsHash);
+}
+
+string ResultCache::FileName(unsigned long long hash)
+{
+  char FN[32];
+  sprintf(FN, "/%016llx.res", hash);
+  return Dir + FN;
+}
+
+void ResultCache::ReadIndex()
+{
+  entries.clear();
+  FILE* f = fopen((Dir + "/index").c_str(), "r");
+  if (f == NULL) return;
+
+  Entry e;
+  int Ncoords;
+  while (fscanf(f, "%llx %llx %d", &e.hash, &e.NumericsHash, &Ncoords) == 3)
+  { e.coords.resize(Ncoords);
+    bool ok = true;
+    for (int i=0; i<Ncoords; i++)
+      if (fscanf(f, "%le", &e.coords[i]) != 1) ok = false;
+    if (!ok) break;
+    entries.push_back(e);
+  }
+  fclose(f);
+}
+
+bool ResultCache::Load(int Ncoords, const double* coords, Result* r)
+{
+  unsigned long long hash = Hash(Ncoords, coords);
+  for (size_t i=0; i<entries.size(); i++)
+    if (entries[i].hash == hash)
+    { MappedResult m;
+      if ( (!m.Open(FileName(hash).c_str())) or (!m.CopyTo(r)) ) return false;
+      return true;
+    }
+  return false;
+}
+
+bool ResultCache::LoadNearest(int Ncoords, const double* coords, Result* r)
+{
+  int nearest = -1;
+  double MinDist = 0;
+  for (size_t i=0; i<entries.size(); i++)
+  { if ( (entries[i].NumericsHash != NumericsHash) or (entries[i].coords.size() != (size_t) Ncoords) ) continue;
+    double dist = 0;
+    for (int j=0; j<Ncoords; j++) 
+      dist += (entries[i].coords[j] - coords[j]) * (entries[i].coords[j] - coords[j]);
+    if ( (nearest == -1) or (dist < MinDist) )
+    { nearest = i;
+      MinDist = dist;
+    }
+  }
+  if (nearest == -1) return false;
+
+  MappedResult m;
+  if ( (!m.Open(FileName(entries[nearest].hash).c_str())) or (!m.CopyTo(r)) ) return false;
+  printf("-- INFO -- ResultCache: starting from a cached result at distance %le\n", sqrt(MinDist));
+  return true;
+}
+
+void ResultCache::Store(int Ncoords, const double* coords, Result* r)
+{
+  unsigned long long hash = Hash(Ncoords, coords);
+  //written under a temporary name first, so an interrupted write never looks like a hit
+  string FN = FileName(hash);
+  if ( (!r->PrintResult((FN + ".tmp").c_str(), ResultFormats::Binary))
+       or (rename((FN + ".tmp").c_str(), FN.c_str()) != 0) )
+  { printf("-- WARNING -- ResultCache: could not store %s, the point is not cached\n", FN.c_str());
+    remove((FN + ".tmp").c_str());
+    return;
+  }
+
+  for (size_t i=0; i<entries.size(); i++)
+    if (entries[i].hash == hash) return;
+
+  Entry e;
+  e.hash = hash;
+  e.NumericsHash = NumericsHash;
+  e.coords.assign(coords, coords + Ncoords);
+  entries.push_back(e);
+
+  FILE* f = fopen((Dir + "/index").c_str(), "a");
+  if (f == NULL) return;
+  fprintf(f, "%016llx %016llx %d", hash, NumericsHash, Ncoords);
+  for (int i=0; i<Ncoords; i++) fprintf(f, " %.17le", coords[i]);
+  fprintf(f, "\n");
+  fclose(f);
+}
@@ -0,0 +1,58 @@
+//*************************************************//
+//    Content addressed cache of converged Results //
+//*************************************************//
+
+// Results are stored in binary format under Dir, named by a 64 bit FNV-1a hash of the
+// numerical setup (grid definition and params) and the physical coordinates of the
+// point (e.g. U, T, n). Dir/index lists all stored points. On a miss, the stored point
+// with the same numerical setup nearest in coordinates can be used as a starting guess.
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+class Result;
+class GRID;
+
+namespace CacheIgnored
+{ //params that change what is printed or how a run is driven, never the converged result
+  const int N = 23;
+  const char* const Names[N] = { "Loop::MAX_ITS", "Loop::PrintIntermediate", "Loop::HaltOnIterations",
+                                 "Loop::AsyncOutput", "Loop::OutputQueueDepth", "Loop::ArchiveHistory",
+                                 "Loop::HistoryFN", "Loop::HistoryKeyframeEvery", "Loop::CheckpointEvery",
+                                 "Loop::CheckpointFN", "Loop::Resume", "CHM::PrintDelta", "CHM::LatticeTableDir",
+                                 "CHM::SiamNt", "TMT::PrintAveraged", "TMT::SiamNt", "TMT::AverageNt",
+                                 "TMT::KramarsKronigNt", "Exec::Affinity", "Exec::FirstCore", "Exec::NCores",
+                                 "Exec::RanksPerNode", "Exec::FirstTouch" };
+}
+
+class ResultCache
+{
+  private:
+    string Dir;
+    unsigned long long NumericsHash;
+
+    struct Entry
+    { unsigned long long hash;
+      unsigned long long NumericsHash;
+      vector<double> coords;
+    };
+    vector<Entry> entries;
+
+    void ReadIndex();
+    unsigned long long Hash(int Ncoords, const double* coords);
+    string FileName(unsigned long long hash);
+
+  public:
+    ResultCache(const char* Dir);
+
+    static unsigned long long FNV1a(const void* data, size_t size, 
+                                    unsigned long long hash = 14695981039346656037ULL);
+    //params lines whose name is in Exclude (swept and driver parameters) or in CacheIgnored do not enter the hash
+    void SetNumerics(GRID* grid, const string &params, int Nexclude = 0, const char** Exclude = NULL);
+
+    bool Load(int Ncoords, const double* coords, Result* r);		//exact hit
+    bool LoadNearest(int Ncoords, const double* coords, Result* r);	//nearest point with same numerics
+    void Store(int Ncoords, const double* coords, Result* r);
+};
@@ -0,0 +1,49 @@
+#include "ResultPool.h"
+#include "Result.h"
+#include "GRID.h"
+
+ResultPool::ResultPool(int Arrays)
+{
+  this->Arrays = Arrays;
+  grid = NULL;
+}
+
+ResultPool::~ResultPool()
+{
+  Clear();
+}
+
+void ResultPool::Clear()
+{
+  for (size_t i=0; i<free.size(); i++) delete free[i];
+  free.clear();
+}
+
+Result* ResultPool::Get(GRID* grid)
+{
+  //pooled Results of another grid size are of no use
+  if ( (this->grid != NULL) and (this->grid->get_N() != grid->get_N()) ) Clear();
+  this->grid = grid;
+
+  if (free.empty()) return new Result(grid, Arrays);
+  Result* r = free.back();
+  free.pop_back();
+  r->grid = grid;
+  return r;
+}
+
+Result* ResultPool::Get(const Result &result)
+{
+  Result* r = Get(result.grid);
+  r->CopyFrom(result);
+  return r;
+}
+
+void ResultPool::Release(Result* r)
+{
+  if (r == NULL) return;
+  if ( (grid != NULL) and (r->grid->get_N() == grid->get_N()) and (r->Arrays == Arrays) )
+    free.push_back(r);
+  else
+    delete r;
+}
@@ -0,0 +1,31 @@
+//*************************************************//
+//    Pool of Result objects on the same grid      //
+//*************************************************//
+
+// Results that are released are kept and handed out again, so that per-iteration
+// temporaries (e.g. the TMT impurities) do not reallocate their arrays. All Results
+// of a pool have the same set of arrays. Not thread safe.
+
+#include <vector>
+
+using namespace std;
+
+class Result;
+class GRID;
+
+class ResultPool
+{
+  private:
+    GRID* grid;
+    int Arrays;
+    vector<Result*> free;
+
+  public:
+    ResultPool(int Arrays);
+    ~ResultPool();
+
+    Result* Get(GRID* grid);			//contents are undefined
+    Result* Get(const Result &result);		//copy of result
+    void Release(Result* r);
+    void Clear();				//frees the pooled Results
+};
@@ -4,6 +4,9 @@
 #include "GRID.h"
 #include "Result.h"
 #include "Input.h"
+#include "LatticeTable.h"
+#include "MatsubaraTransform.h"
+#include <cstring>
 
 #ifdef _OMP
 #include <omp.h>
@@ -23,6 +26,12 @@ void SIAM::Defaults()
 
   //broadening
   eta = 5e-2;
+
+#ifdef _OMP
+  Nt = omp_get_max_threads();
+#else
+  Nt = 1;
+#endif
    
   //options
   CheckSpectralWeight = false; //default false
@@ -32,6 +41,21 @@ void SIAM::Defaults()
   UseLatticeSpecificG = false;
   t = 0.5;
   LatticeType = DOStypes::SemiCircle;
+
+  UseMPT_Binit = false;
+  MPT_Binit = 0.0;
+
+  LStable = NULL;
+  NIDOStable = NULL;
+  NIDOSsource = NULL;
+  NIDOSsourceN = 0;
+
+  matsubara = NULL;
+
+  FermiCache = NULL;
+  FermiGrid = NULL;
+  FermiN = 0;
+  FermiT = 0.0;
 }
 
 SIAM::SIAM()
@@ -60,7 +84,10 @@ SIAM::SIAM(const char* ParamsFN)
 
 SIAM::~SIAM()
 {
-
+  delete NIDOStable;
+  delete [] NIDOSsource;
+  delete matsubara;
+  delete [] FermiCache;
 }
 
 //========================= INITIALIZERS ===========================//
@@ -100,6 +127,11 @@ void SIAM::SetBroadening(double eta)
   this->eta = eta;
 }
 
+void SIAM::SetNt(int Nt)
+{
+  this->Nt = Nt;
+}
+
 void SIAM::SetIsBethe(bool isBethe)
 {
   this->isBethe = isBethe;
@@ -110,6 +142,13 @@ void SIAM::SetUseLatticeSpecificG(bool UseLatticeSpecificG, double t, int Lattic
   this->UseLatticeSpecificG = UseLatticeSpecificG;
   this->t = t;
   this->LatticeType = LatticeType;
+  LStable = ( UseLatticeSpecificG and (LatticeType == DOStypes::CubicLattice) ) ? LatticeTable::Get(LatticeType, t) : NULL;
+}
+
+void SIAM::SetInitialMPT_B(double MPT_B)
+{
+  UseMPT_Binit = true;
+  MPT_Binit = MPT_B;
 }
 
 //========================= RUN SIAM EITH FIXED Mu ==========================//
@@ -135,9 +174,10 @@ bool SIAM::Run(Result* r) //output
   r->n = 0.5;  
   mu0 = r->mu0;  
   if ((!SymmetricCase)and(UseMPT_Bs))
-     MPT_B = epsilon;
+     MPT_B = (UseMPT_Binit) ? MPT_Binit : epsilon;
   else
      MPT_B = 0.0;
+  UseMPT_Binit = false;
 
   complex<double>* V = new complex<double>[2];
   V[0] = mu0; 
@@ -173,10 +213,15 @@ bool SIAM::Run(Result* r) //output
   //output spectral weight if optioned
   if (CheckSpectralWeight)
   {
-    printf("        Spectral weight G: %fe\n", -imag(TrapezIntegralMP(N, r->G, r->omega))/pi);
-    printf("        Spectral weight G0: %fe\n", -imag(TrapezIntegralMP(N, r->G0, r->omega))/pi);
+    printf("        Spectral weight G: %fe\n", -imag(grid->Integrate(r->G))/pi);
+    printf("        Spectral weight G0: %fe\n", -imag(grid->Integrate(r->G0))/pi);
   }
 
+  // fill in DOS
+  #pragma omp parallel for num_threads(Nt)
+  for (int i=0; i<N; i++)
+    r->DOS[i] = - imag(r->G[i]) / pi;
+
   r->mu0 = mu0;
 
   return Clipped;
@@ -229,7 +274,6 @@ bool SIAM::Run_CHM(Result* r) //output
 
   printf("    mu0 = %f\n", mu0);
   
-  get_As();
   get_Ps();
   get_SOCSigma();
 
@@ -266,7 +310,7 @@ bool SIAM::Run_CHM(Result* r) //output
   }
 
   // fill in DOS
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++)
     r->DOS[i] = - imag(r->G[i]) / pi;
 
@@ -279,26 +323,34 @@ bool SIAM::Run_CHM(Result* r) //output
 
 double SIAM::get_fermi(int i)
 {
-  return 1.0 / ( 1.0 + exp( r->omega[i]/T ) );
+  return Fermi(r->omega[i], T);
 }
 
 void SIAM::get_fermi()
-{  
-  #pragma omp parallel for
-  for (int i=0; i<N; i++) 
-  { //printf("tid: %d i: %d\n",omp_get_thread_num(),i);
-    r->fermi[i] = get_fermi(i);
+{ //kept for the next Run at the same grid and T, e.g. the impurities of TMT
+  if ( (FermiGrid != grid) or (FermiN != N) or (FermiT != T) )
+  { delete [] FermiCache;
+    FermiCache = new double[N];
+    FermiGrid = grid;
+    FermiN = N;
+    FermiT = T;
+    Fermi(N, r->omega, T, FermiCache);
   }
+  memcpy(r->fermi, FermiCache, N*sizeof(double));
 }
 
 void SIAM::get_G0()
-{
-  #pragma omp parallel for
+{ //spectral functions Ap and Am are filled in the same pass
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
-    r->G0[i] = complex<double>(1.0)
-               / ( complex<double>(r->omega[i] + mu0, eta)
-                   - r->Delta[i] ); 
-
+  { complex<double> G0 = complex<double>(1.0)
+                         / ( complex<double>(r->omega[i] + mu0, eta)
+                             - r->Delta[i] ); 
+    double A = -imag(G0) / pi;
+    r->G0[i] = G0;
+    r->Ap[i] = A * r->fermi[i];
+    r->Am[i] = A * (1.0 - r->fermi[i]);
+  }
 }
 
 void SIAM::get_G0(complex<double>* V)
@@ -314,31 +366,21 @@ void SIAM::get_G0(complex<double>* V)
 double SIAM::get_n(complex<double> X[])
 {
   double* g = new double[N];
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
     g[i]=-(1/pi)*imag(X[i])*r->fermi[i];
   
-  double n = TrapezIntegralMP(N, g, r->omega);
+  double n = grid->Integrate(g);
   delete [] g;
   return n; 
 }
 
-void SIAM::get_As() 
-{
-  #pragma omp parallel for
-  for (int i=0; i<N; i++)
-  { //printf("tid: %d i: %d\n",omp_get_thread_num(),i);
-    r->Ap[i] = -imag(r->G0[i]) * r->fermi[i] / pi;
-    r->Am[i] = -imag(r->G0[i]) * (1.0 - r->fermi[i]) / pi;
-  }
-}
-
 void SIAM::get_Ps()
 {
   double** p1 = new double*[N];
   double** p2 = new double*[N];
 
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
   { 
       p1[i] = new double[N];
@@ -350,8 +392,8 @@ void SIAM::get_Ps()
       }
 
       //get Ps by integrating                           
-      r->P1[i] = pi * TrapezIntegral(N, p1[i], r->omega);
-      r->P2[i] = pi * TrapezIntegral(N, p2[i], r->omega);
+      r->P1[i] = pi * WeightedSum(N, grid->get_weights(), p1[i]);
+      r->P2[i] = pi * WeightedSum(N, grid->get_weights(), p2[i]);
 
       delete [] p1[i];
       delete [] p2[i];
@@ -364,7 +406,7 @@ void SIAM::get_Ps()
 void SIAM::get_SOCSigma()
 {
     double** s = new double*[N];
-    #pragma omp parallel for 
+    #pragma omp parallel for num_threads(Nt)
     for (int i=0; i<N; i++) 
     { //printf("tid: %d i: %d\n",omp_get_thread_num(),i);
       s[i] = new double[N];
@@ -376,7 +418,7 @@ void SIAM::get_SOCSigma()
                          
       //integrate
   
-      r->SOCSigma[i] = complex<double>(0.0, - U*U * TrapezIntegral(N, s[i], r->omega) );    
+      r->SOCSigma[i] = complex<double>(0.0, - U*U * WeightedSum(N, grid->get_weights(), s[i]) );    
      
       if (ClipOff( r->SOCSigma[i] )) Clipped = true ;
       delete [] s[i];
@@ -385,7 +427,7 @@ void SIAM::get_SOCSigma()
   //int i;
   //cin >> i;
   if (Clipped) printf("    !!!Clipping SOCSigma!!!!\n");
-  grid->KramarsKronig( r->SOCSigma );
+  grid->KramarsKronig( r->SOCSigma, Nt );
 }
 
 double SIAM::get_MPT_B0()
@@ -393,11 +435,11 @@ double SIAM::get_MPT_B0()
   if (!UseMPT_Bs) return 0.0;
   
   complex<double>* b0 = new complex<double>[N]; //integrand function
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
     b0[i] = r->fermi[i] * r->Delta[i] * r->G0[i];
   
-  double mpt_b0 = epsilon - 1.0  * (2.0 * r->n - 1.0) * imag(TrapezIntegralMP(N, b0, r->omega))
+  double mpt_b0 = epsilon - 1.0  * (2.0 * r->n - 1.0) * imag(grid->Integrate(b0))
                            / ( pi * r->n * (1.0 - r->n) ) ;
   delete [] b0;
   return mpt_b0;
@@ -408,13 +450,13 @@ double SIAM::get_MPT_B()
   if (!UseMPT_Bs) return 0.0;
   
   complex<double>* b = new complex<double>[N];
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
     b[i] = r->fermi[i] * r->Delta[i] * r->G[i]
            * ( (2.0 / U) * r->Sigma[i] - 1.0 );
   
   double mpt_b = epsilon - 1.0/( pi * r->n * (1.0 - r->n) ) 
-                           * imag(TrapezIntegralMP(N, b, r->omega));
+                           * imag(grid->Integrate(b));
   delete [] b;
   return mpt_b;
 }
@@ -434,14 +476,14 @@ void SIAM::get_Sigma()
   if (!SymmetricCase)
   { //printf("going through asymmetric\n");
     double b = get_b();    
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads(Nt)
     for (int i=0; i<N; i++) 
       r->Sigma[i] =  U*r->n + r->SOCSigma[i] 
                               / ( 1.0 - b * r->SOCSigma[i] );
     
   }
   else
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads(Nt)
     for (int i=0; i<N; i++) 
       r->Sigma[i] =  U * r->n + r->SOCSigma[i];
 
@@ -452,16 +494,16 @@ void SIAM::get_Sigma()
 void SIAM::get_G()
 {
   if (UseLatticeSpecificG) 
-    #pragma omp parallel for
+    #pragma omp parallel for num_threads(Nt)
     for (int i=0; i<N; i++) 
     { complex<double> com = r->omega[i] + r->mu - r->Sigma[i];
-      r->G[i] = LS_get_G(LatticeType, t, com);
+      r->G[i] = LS_get_G(LatticeType, t, com, LStable);
     }
   else
   {
   
   
-  #pragma omp parallel for
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
   {    
     r->G[i] =  1.0
@@ -491,49 +533,40 @@ void SIAM::get_G_CHM()
 
   get_Sigma();   
   
-  if (UseLatticeSpecificG) 
-    #pragma omp parallel for
-    for (int i=0; i<N; i++) 
-    { complex<double> com = r->omega[i] + r->mu - r->Sigma[i];
-      r->G[i] = LS_get_G(LatticeType, t, com);
-    }
-  else
-  {
+  //both are O(N): analytic or tabulated G of the lattice, or the tabulated Hilbert transform of NIDOS
+  if (!UseLatticeSpecificG) UpdateNIDOStable();
 
-  complex<double>** g = new complex<double>*[N];
-  #pragma omp parallel for
+  bool ClippedG = false;
+  #pragma omp parallel for num_threads(Nt)
   for (int i=0; i<N; i++) 
-  {
-      
-    //treat integrand carefully 
-    double D = 0.0;
-    complex<double> LogTerm = 0.0;
-    if (abs(imag(r->Sigma[i]))<0.1) 
-    {
-      D = grid->interpl(r->NIDOS, r->mu + r->omega[i] - real(r->Sigma[i]));
-      LogTerm = complex<double>(D, 0.0) * log( (r->mu + r->omega[i] - r->Sigma[i] + r->omega[N-1])
-                                              /(r->mu + r->omega[i] - r->Sigma[i] - r->omega[N-1]) );
+  { complex<double> com = r->omega[i] + r->mu - r->Sigma[i];
+    if (UseLatticeSpecificG) 
+      r->G[i] = LS_get_G(LatticeType, t, com, LStable);
+    else
+    { r->G[i] = NIDOStable->get_G(com);
+      if (ClipOff(r->G[i])) ClippedG = true;
     }
-
-    //create integrand array
-    g[i] = new complex<double>[N];  
-    for (int j=0; j<N; j++)
-      g[i][j] = complex<double>(r->NIDOS[j] - D, 0.0) 
-             / ( r->mu + r->omega[i] - r->omega[j] - r->Sigma[i] ); 
-    
-  
-    //integrate to get G 
-    r->G[i] = TrapezIntegral(N, g[i], r->omega) + LogTerm ; 
-
-    if (ClipOff(r->G[i])) Clipped = true;
-    delete [] g[i];
   }
   
-  delete [] g;    
-  
-  if (Clipped) printf("    !!!!Clipping G!!!!\n");
+  if (ClippedG)
+  { Clipped = true;
+    printf("    !!!!Clipping G!!!!\n");
+  }
+}
 
+void SIAM::UpdateNIDOStable()
+{
+  if ( (NIDOStable != NULL) and (NIDOSsourceN == N)
+       and (memcmp(NIDOSsource, r->NIDOS, N*sizeof(double)) == 0) ) return;
+
+  if (NIDOStable == NULL) NIDOStable = new LatticeTable();
+  NIDOStable->Build(N, r->omega, r->NIDOS);
+  if (NIDOSsourceN != N)
+  { delete [] NIDOSsource;
+    NIDOSsource = new double[N];
+    NIDOSsourceN = N;
   }
+  memcpy(NIDOSsource, r->NIDOS, N*sizeof(double));
 }
 
 void SIAM::get_G_CHM(complex<double>* V)
@@ -558,7 +591,6 @@ void SIAM::SolveSiam(complex<double>* V)
   r->n = get_n(r->G0);
   MPT_B0 = get_MPT_B0();  
 
-  get_As();
   get_Ps();
   get_SOCSigma();
   get_Sigma();   
@@ -596,16 +628,20 @@ double SIAM::MatsFreq(int m)
 
 void SIAM::GetGfOnImagAxis(int M, complex<double> * G_out)
 { 
-  complex<double>* g = new complex<double>[N];
-  double* mf = new double[M];
-  for(int m=0; m<M; m++)
-  { 
-    mf[m]=MatsFreq(m);
-    for(int i=0; i<N; i++)
-      g[i] = imag(r->G[i]) / complex<double>( -r->omega[i], mf[m] );
-    
-    G_out[m] = -1/(pi)*TrapezIntegral(N, g, r->omega);
-  }
-  delete [] g;
-  delete [] mf;
+  GetOnImagAxis(r, M, G_out, NULL, NULL);
+}
+
+void SIAM::GetOnImagAxis(Result* r, int M, complex<double>* G_out, complex<double>* Sigma_out, complex<double>* Delta_out)
+{ //all requested functions in one pass over the kernel, Sigma tends to the Hartree term U n
+  complex<double>* F[3];
+  complex<double>* F_out[3];
+  double Finf[3];
+  int Nf = 0;
+  if (G_out != NULL) { F[Nf] = r->G; F_out[Nf] = G_out; Finf[Nf] = 0.0; Nf++; }
+  if (Sigma_out != NULL) { F[Nf] = r->Sigma; F_out[Nf] = Sigma_out; Finf[Nf] = U * r->n; Nf++; }
+  if (Delta_out != NULL) { F[Nf] = r->Delta; F_out[Nf] = Delta_out; Finf[Nf] = 0.0; Nf++; }
+  if (Nf == 0) return;
+
+  if (matsubara == NULL) matsubara = new MatsubaraTransform();
+  matsubara->Transform(r->grid, r->omega, T, M, Nf, F, Finf, F_out);
 }
@@ -8,6 +8,8 @@
 
 class Result;
 class GRID;
+class LatticeTable;
+class MatsubaraTransform;
 
 using namespace std;
 
@@ -41,6 +43,13 @@ class SIAM
     bool UseLatticeSpecificG;
     int LatticeType;
     double t;
+
+    //--tabulated Hilbert transform of NIDOS, rebuilt when NIDOS changes--//
+    LatticeTable* LStable;	//table of a CubicLattice for UseLatticeSpecificG, NULL for analytic G
+    LatticeTable* NIDOStable;
+    double* NIDOSsource;
+    int NIDOSsourceN;
+    void UpdateNIDOStable();
     
     //--don't touch this---//
     bool SymmetricCase;
@@ -50,23 +59,33 @@ class SIAM
     double Accr;
     int MAX_ITS;  
 
+    //--threads of the parallel loops, set per phase by the caller--//
+    int Nt;
+
     //--MPT Higher order correlations--//
     double MPT_B;
     double MPT_B0;
+    bool UseMPT_Binit;		//if set, Run starts from MPT_Binit instead of the default guess
+    double MPT_Binit;
     
     //--storage arrays--//
     GRID* grid;
     int N;
 
+    //--fermi function of the last grid and T--//
+    double* FermiCache;
+    GRID* FermiGrid;
+    int FermiN;
+    double FermiT;
+
      //--get functions--//
     double get_fermi(int i);
     double get_n(complex<double> X[]);
 
     //--get procedures--//
     void get_fermi();
-    void get_G0();
+    void get_G0();		//also Ap and Am
     void get_G0(complex<double>* V);
-    void get_As();
     void get_Ps();  
     void get_SOCSigma();
     double get_MPT_B();
@@ -83,6 +102,7 @@ class SIAM
 
     //--imaginary axis--// 
     double MatsFreq(int n);
+    MatsubaraTransform* matsubara;	//kernel is kept for calls at the same T
 
     //--- SIAM solver ---//
     void SolveSiam(complex<double>* V);
@@ -92,6 +112,7 @@ class SIAM
     bool CheckSpectralWeight;   //if true program prints out spectral weights of G and G0 after each iteration
     void SetBroydenParameters(int MAX_ITS, double Accr);
     void SetBroadening(double eta);
+    void SetNt(int Nt);
     void SetDOStype_CHM(int DOStype, double t, const char* FileName ="");
     void SetIsBethe(bool isBethe);
     void SetT(double T);
@@ -100,6 +121,9 @@ class SIAM
     void SetUTepsilon(double U, double T, double epsilon);
 
     void SetUseLatticeSpecificG(bool UseLatticeSpecificG, double t, int LatticeType);
+    void SetInitialMPT_B(double MPT_B); //initial guess for the next Run only
+
+    double GetMPT_B() { return MPT_B; };
 
     //--Constructors/destructors--//
     SIAM();  
@@ -108,6 +132,8 @@ class SIAM
     
     //get G on inamginary axis
     void GetGfOnImagAxis(int Nmax, complex<double>* G_out);
+    void GetOnImagAxis(Result* r, int M, complex<double>* G_out, complex<double>* Sigma_out, complex<double>* Delta_out); //NULL to skip
+    MatsubaraTransform* get_MatsubaraTransform() { return matsubara; };	//moments and tail sums of the last call
     
     //--------RUN SIAM--------//
     
@@ -7,6 +7,10 @@
 #include "SIAM.h"
 #include "TMT.h"
 #include "Input.h"
+#include "ImpurityCache.h"
+#include "ResultPool.h"
+#include "ExecutionContext.h"
+#include "AsyncWriter.h"
 
 #ifdef _MPI
 #include "mpi.h"
@@ -21,19 +25,38 @@ void TMT::Defaults()
   W = 0.1;
   Distribution = Distributions::Uniform;
   Nimp = 10;
+  Quadrature = Quadratures::Equidistant;
+  GaussianCutoff = 3.0;
+  UseParticleHoleSymmetry = false;
+  SymmetryAccr = 1e-8;
+  Adaptive = false;
+  AdaptiveStartLevel = 2;
+  AdaptiveMaxLevel = 6;
+  AdaptiveAccr = 1e-3;
+  AverageError = 0;
   CHM::UseBethe = true;
 
+  cache = new ImpurityCache();
+  impurities = new ResultPool(ResultArrays::Siam);
+  CacheHistoryDepth = 2;
+  ExtrapolateWarmStart = false;
+
   AverageNt = 8;
   SiamNt = 1;
   KramarsKronigNt = 8;
+  SetTeamSizes(AverageNt, SiamNt, KramarsKronigNt);
 
   ExitSignal = -1000.0;
+#ifdef _MPI
+  PrintAveraged = true;
+#else
+  PrintAveraged = false;
+#endif
 }
 
 TMT::TMT() : CHM()
 {
   Defaults();
-  mu0grid = new double[Nimp];
 }
 
 TMT::TMT(const char* ParamsFN) : CHM(ParamsFN)
@@ -48,31 +71,71 @@ TMT::TMT(const char* ParamsFN) : CHM(ParamsFN)
   input.ReadParam(W,"TMT::W");
   input.ReadParam(Distribution,"TMT::Distribution");
   input.ReadParam(Nimp,"TMT::Nimp");
+  input.ReadParam(Quadrature,"TMT::Quadrature");
+  input.ReadParam(GaussianCutoff,"TMT::GaussianCutoff");
+  input.ReadParam(UseParticleHoleSymmetry,"TMT::UseParticleHoleSymmetry");
+  input.ReadParam(SymmetryAccr,"TMT::SymmetryAccr");
+  input.ReadParam(Adaptive,"TMT::Adaptive");
+  input.ReadParam(AdaptiveStartLevel,"TMT::AdaptiveStartLevel");
+  input.ReadParam(AdaptiveMaxLevel,"TMT::AdaptiveMaxLevel");
+  input.ReadParam(AdaptiveAccr,"TMT::AdaptiveAccr");
+  if (Adaptive) SetAdaptive(Adaptive, AdaptiveStartLevel, AdaptiveMaxLevel, AdaptiveAccr);
+  input.ReadParam(CacheHistoryDepth,"TMT::CacheHistoryDepth");
+  input.ReadParam(ExtrapolateWarmStart,"TMT::ExtrapolateWarmStart");
   input.ReadParam(AverageNt,"TMT::AverageNt");
   input.ReadParam(SiamNt,"TMT::SiamNt");
   input.ReadParam(KramarsKronigNt,"TMT::KramarsKronigNt");
-  
-  mu0grid = new double[Nimp];
-  for (int i = 0; i<Nimp; i++) mu0grid[i] = 0;
-  //----------------------------------------------------------------------------------------------------//
-  // NEVER FORGET TO SET VALUES TO A NEWLY INITIALIZED DYNAMIC ARRAY. BY DEFAULT THESE VALUES ARE NOT 0 //
-  //----------------------------------------------------------------------------------------------------//
+  input.ReadParam(PrintAveraged,"TMT::PrintAveraged");
+  SetTeamSizes(AverageNt, SiamNt, KramarsKronigNt);
 }
 
-TMT::~TMT() 
+void TMT::SetTeamSizes(int AverageNt, int SiamNt, int KramarsKronigNt)
 {
-  siam->~SIAM();
-  delete [] mu0grid;
+  this->AverageNt = AverageNt;
+  this->SiamNt = SiamNt;
+  this->KramarsKronigNt = KramarsKronigNt;
+  exec->SetTeamSize(Phases::Average, AverageNt);
+  exec->SetTeamSize(Phases::Siam, SiamNt);
+  exec->SetTeamSize(Phases::KramarsKronig, KramarsKronigNt);
+}
+
+TMT::~TMT() 
+{ //siam is released by CHM
+  delete cache;
+  delete impurities;
 }
 
 void TMT::SetWDN(double W, int Distribution, int Nimp)
 {
   this->W = W;
   this->Distribution = Distribution;
-  this->Nimp = Nimp;
-  delete [] mu0grid;
-  mu0grid = new double[Nimp];
-  for (int i = 0; i<Nimp; i++) mu0grid[i] = 0;
+  this->Nimp = (Adaptive) ? (1 << AdaptiveMaxLevel) + 1 : Nimp;
+  cache->Clear();
+}
+
+void TMT::SetAdaptive(bool Adaptive, int StartLevel, int MaxLevel, double Accr)
+{
+  this->Adaptive = Adaptive;
+  AdaptiveMaxLevel = (MaxLevel < 1) ? 1 : MaxLevel;
+  AdaptiveStartLevel = (StartLevel > AdaptiveMaxLevel) ? AdaptiveMaxLevel : StartLevel;
+  if (AdaptiveStartLevel < 1) AdaptiveStartLevel = 1;
+  AdaptiveAccr = Accr;
+  if (Adaptive) 
+  { Nimp = (1 << AdaptiveMaxLevel) + 1;
+    printf("-- INFO -- TMT: adaptive average, levels %d to %d, finest grid of %d impurities\n", 
+           AdaptiveStartLevel, AdaptiveMaxLevel, Nimp);
+  }
+  cache->Clear();
+}
+
+void TMT::SetQuadrature(int Quadrature)
+{
+  this->Quadrature = Quadrature;
+}
+
+void TMT::SetUseParticleHoleSymmetry(bool UseParticleHoleSymmetry)
+{
+  this->UseParticleHoleSymmetry = UseParticleHoleSymmetry;
 }
 
 void TMT::SetUseBethe(bool UseBethe)
@@ -96,9 +159,7 @@ double TMT::P(double epsilon)
   switch (Distribution)
   {
     case Distributions::Uniform : return 1.0/W; 
-    case Distributions::Gaussian :
-    { return 0; //TODO 
-    } 
+    case Distributions::Gaussian : return exp( - sqr(epsilon) / (2.0 * sqr(W)) ) / ( sqrt(2.0*pi) * W );
     default : return 0;
   }
 }
@@ -106,39 +167,267 @@ double TMT::P(double epsilon)
 void TMT::MakeEgrid()
 {
   Egrid = new double[Nimp];
+  Wgrid = new double[Nimp];
+
+  if ((W==0.0)or(Nimp==1))
+  { for (int i=0; i<Nimp; i++)
+    { Egrid[i] = 0;
+      Wgrid[i] = 1.0/Nimp;
+    }
+    return;
+  }
+
+  //adaptive average needs nested grids
+  switch ( (Adaptive) ? Quadratures::Equidistant : Quadrature )
+  {
+    case Quadratures::Gauss :
+    { if (Distribution == Distributions::Gaussian)
+      { //int P(e) f(e) de = sum_i w_i/sqrt(pi) f(sqrt(2) W x_i)
+        GaussHermite(Nimp, Egrid, Wgrid);
+        for (int i=0; i<Nimp; i++)
+        { Egrid[i] *= sqrt(2.0) * W;
+          Wgrid[i] /= sqrt(pi);
+        }
+      }
+      else
+      { GaussLegendre(Nimp, -W/2.0, W/2.0, Egrid, Wgrid);
+        for (int i=0; i<Nimp; i++) Wgrid[i] *= P(Egrid[i]);
+      }
+    } break;
+    default :
+    { if (Distribution == Distributions::Gaussian)
+      { //equidistant grid on a finite interval, weights normalized to account for the cut tails
+        double sum = 0;
+        for (int i=0; i<Nimp; i++)
+        { Egrid[i] = - GaussianCutoff * W + i * 2.0 * GaussianCutoff * W / ( Nimp - 1.0 );
+          Wgrid[i] = P(Egrid[i]);
+          sum += Wgrid[i];
+        }
+        for (int i=0; i<Nimp; i++) Wgrid[i] /= sum;
+      }
+      else
+        for (int i=0; i<Nimp; i++)
+        { Egrid[i] = - W/2.0 + i * W / ( Nimp - 1.0 );
+          Wgrid[i] = 1.0/Nimp;
+        }
+    }
+  }
+}
+
+//------------------ particle-hole symmetry ----------------------//
+// At mu=U/2, with a symmetric distribution and bath, the impurity with level -epsilon
+// is the particle-hole mirror of the one with epsilon: DOS(omega) -> DOS(-omega), mu0 -> -mu0.
+
+bool TMT::IsParticleHoleSymmetric()
+{
+  if (abs(r->mu - U/2.0) > SymmetryAccr) return false;
+
   for (int i=0; i<Nimp; i++)
-    Egrid[i] = (W!=0.0) ? - W/2.0 + i * W / ( Nimp - 1.0 ) : 0;
+    if ( (abs(Egrid[i] + Egrid[Nimp-1-i]) > SymmetryAccr)
+         or (abs(Wgrid[i] - Wgrid[Nimp-1-i]) > SymmetryAccr) ) return false;
+
+  //the bath is not checked: it is symmetric up to the accuracy of the impurity solver and
+  //stays symmetric once the mirrored DOS is used in the self-consistency
+  for (int i=0; i<N; i++)
+    if (abs(r->omega[i] + r->omega[N-1-i]) > SymmetryAccr) return false;
+
+  return true;
 }
 
-void TMT::Avarage(Result** R)
+int TMT::MakeSolveList(Result** R, int Nrequest, int* Request, int* List)
+{ //fills List with indices of impurities that have to be solved to have all requested ones, returns their number
+  int Nsolve = 0;
+  for (int l=0; l<Nrequest; l++)
+  { int i = Request[l];
+    if (R[i] != NULL) continue;
+    //Egrid is ascending, so with the symmetry only epsilon>=0 are solved
+    int s = ( Symmetric and (i < Nimp/2) ) ? Nimp-1-i : i;
+    if (R[s] != NULL) continue;
+    bool Listed = false;
+    for (int j=0; j<Nsolve; j++)
+      if (List[j] == s) Listed = true;
+    if (!Listed) List[Nsolve++] = s;
+  }
+  return Nsolve;
+}
+
+void TMT::MirrorImpurities(Result** R, int Nrequest, int* Request)
+{ //fills in requested impurities that were not solved with mirrors of solved ones
+  for (int l=0; l<Nrequest; l++)
+  { int i = Request[l];
+    int m = Nimp-1-i;
+    if ( (R[i] != NULL) or (R[m] == NULL) ) continue;
+    R[i] = impurities->Get(r->grid);	//only DOS and mu0 of a mirror are used
+    for (int k=0; k<N; k++)
+      R[i]->DOS[k] = R[m]->DOS[N-1-k];
+    R[i]->mu0 = - R[m]->mu0;
+    cache->Mirror(m, i);
+  }
+}
+
+bool TMT::SolveRequested(Result** R, int Nrequest, int* Request, int &Nsolved)
 {
-#ifdef _OMP
-  omp_set_num_threads(AverageNt);
-#endif
+  int* List = new int[Nimp];
+  int Nsolve = MakeSolveList(R, Nrequest, Request, List);
+  bool Error = SolveImpurities(R, Nsolve, List);
+  MirrorImpurities(R, Nrequest, Request);
+  Nsolved += Nsolve;
+  delete [] List;
+  return Error;
+}
 
-  #pragma omp parallel shared(R)
-  { 
-    #pragma omp parallel for 
+//------------------ adaptive average ----------------------//
+// Egrid is the finest equidistant grid of 2^AdaptiveMaxLevel+1 points. Averaging starts
+// on the sub-grid of level AdaptiveStartLevel. Each interval [a,b] is checked by solving its
+// midpoint m and comparing the trapezoid rules on [a,b] and [a,m,b] for P*log(DOS).
+// Intervals where the two differ by more than their share of AdaptiveAccr are split further.
+
+double TMT::IntervalError(Result** R, int a, int m, int b)
+{ //error estimate of the typical DOS, relative to its maximum, coming from interval [a,b]
+  double h = Egrid[b] - Egrid[a];
+  double Pm = P(Egrid[m]);
+  double MaxErr = 0;
+  double MaxDOS = 0;
+  for (int i=0; i<N; i++)
+  { if ( (R[a]->DOS[i] <= 0) or (R[m]->DOS[i] <= 0) or (R[b]->DOS[i] <= 0) ) continue;
+    double la = log(R[a]->DOS[i]);
+    double lm = log(R[m]->DOS[i]);
+    double lb = log(R[b]->DOS[i]);
+    double dos = exp(0.25*(la + 2.0*lm + lb));
+    double err = dos * 0.25 * h * Pm * abs(2.0*lm - la - lb);
+    if (err > MaxErr) MaxErr = err;
+    if (dos > MaxDOS) MaxDOS = dos;
+  }
+  return (MaxDOS > 0) ? MaxErr/MaxDOS : 0;
+}
+
+bool TMT::AdaptiveSolve(Result** R)
+{
+  bool Error = false;
+  int Nsolved = 0;
+  double Span = Egrid[Nimp-1] - Egrid[0];
+
+  int* Request = new int[Nimp];
+  int* Ia = new int[Nimp];	//pending intervals
+  int* Ib = new int[Nimp];
+  double* Ierr = new double[Nimp];	//error estimate inherited from the parent interval
+  int* Na = new int[Nimp];	//intervals for the next round
+  int* Nb = new int[Nimp];
+  double* Nerr = new double[Nimp];
+  int* Aa = new int[Nimp];	//accepted intervals
+  int* Ab = new int[Nimp];
+  int Naccepted = 0;
+  AverageError = 0;
+
+  //---- starting level ----//
+  int stride = 1 << (AdaptiveMaxLevel - AdaptiveStartLevel);
+  int Nrequest = 0;
+  for (int i=0; i<Nimp; i+=stride) Request[Nrequest++] = i;
+  Error = SolveRequested(R, Nrequest, Request, Nsolved);
+
+  int Npending = 0;
+  for (int i=0; i+stride<Nimp; i+=stride)
+  { Ia[Npending] = i;
+    Ib[Npending] = i + stride;
+    Ierr[Npending] = 0;
+    Npending++;
+  }
+
+  //---- refinement ----//
+  while (Npending > 0)
+  {
+    Nrequest = 0;
+    for (int l=0; l<Npending; l++)
+      if (Ib[l] - Ia[l] > 1) Request[Nrequest++] = (Ia[l] + Ib[l])/2;
+    if ( (!Error) and (Nrequest > 0) )
+      Error = SolveRequested(R, Nrequest, Request, Nsolved);
+
+    int Nnext = 0;
+    for (int l=0; l<Npending; l++)
+    { int a = Ia[l];
+      int b = Ib[l];
+      int m = (a+b)/2;
+      if ( (b-a == 1) or (R[m] == NULL) )
+      { //can not be split any more
+        Aa[Naccepted] = a;
+        Ab[Naccepted] = b;
+        Naccepted++;
+        AverageError += Ierr[l];
+        continue;
+      }
+      double err = IntervalError(R, a, m, b);
+      if (err <= AdaptiveAccr * (Egrid[b] - Egrid[a]) / Span)
+      { Aa[Naccepted] = a;   Ab[Naccepted] = m;   Naccepted++;
+        Aa[Naccepted] = m;   Ab[Naccepted] = b;   Naccepted++;
+        AverageError += err;
+      }
+      else
+      { //error of each half is expected to be at least 4 times smaller
+        Na[Nnext] = a;   Nb[Nnext] = m;   Nerr[Nnext] = 0.25*err;   Nnext++;
+        Na[Nnext] = m;   Nb[Nnext] = b;   Nerr[Nnext] = 0.25*err;   Nnext++;
+      }
+    }
+
+    int* tmp;
+    tmp = Ia; Ia = Na; Na = tmp;
+    tmp = Ib; Ib = Nb; Nb = tmp;
+    double* dtmp = Ierr; Ierr = Nerr; Nerr = dtmp;
+    Npending = Nnext;
+  }
+
+  //---- trapezoid weights on accepted intervals ----//
+  for (int i=0; i<Nimp; i++) Wgrid[i] = 0;
+  for (int l=0; l<Naccepted; l++)
+  { double h = Egrid[Ab[l]] - Egrid[Aa[l]];
+    Wgrid[Aa[l]] += 0.5 * h * P(Egrid[Aa[l]]);
+    Wgrid[Ab[l]] += 0.5 * h * P(Egrid[Ab[l]]);
+  }
+  double sum = 0;
+  int Nused = 0;
+  for (int i=0; i<Nimp; i++) 
+  { sum += Wgrid[i];
+    if (Wgrid[i] > 0) Nused++;
+  }
+  for (int i=0; i<Nimp; i++) Wgrid[i] /= sum;
+
+  printf("-- INFO -- TMT: adaptive average over %d impurities (%d solved), error estimate %le\n", Nused, Nsolved, AverageError);
+
+  delete [] Request;
+  delete [] Ia;
+  delete [] Ib;
+  delete [] Ierr;
+  delete [] Na;
+  delete [] Nb;
+  delete [] Nerr;
+  delete [] Aa;
+  delete [] Ab;
+
+  return Error;
+}
+
+void TMT::Avarage(Result** R)
+{
+  { ThreadTeam team(exec, Phases::Average);
+    #pragma omp parallel for shared(R) num_threads(team.get_Nt())
     for (int i=0; i<N; i++)
     { 
       double dosi = 0;
       for (int j=0; j<Nimp; j++)
-        dosi += (1.0/Nimp) * log(R[j]->DOS[i]);        
+        if (Wgrid[j] != 0.0)
+          dosi += Wgrid[j] * log(R[j]->DOS[i]);        
       r->DOS[i] = exp(dosi);
       r->G[i] = complex<double>(0.0, -pi * r->DOS[i]); 
 
       double dosmedi = 0; 
       for (int j=0; j<Nimp; j++)
-        dosmedi += R[j]->DOS[i];        
-      r->DOSmed[i] = dosmedi/Nimp;    
+        if (Wgrid[j] != 0.0)
+          dosmedi += Wgrid[j] * R[j]->DOS[i];        
+      r->DOSmed[i] = dosmedi;    
     }
-  } //end of parallel
-
-#ifdef _OMP
-  omp_set_num_threads(KramarsKronigNt);
-#endif
+  }
 
-  r->grid->KramarsKronig(r->G);
+  ThreadTeam team(exec, Phases::KramarsKronig);
+  r->grid->KramarsKronig(r->G, team.get_Nt());
 }
 
 void TMT::PrepareResult(Result* R, double mu, double mu0, double* ReDelta, double* ImDelta)
@@ -152,16 +441,44 @@ void TMT::PrepareResult(Result* R, double mu, double mu0, double* ReDelta, doubl
     R->Delta[j] = complex<double>(ReDelta[j],ImDelta[j]);
 }
 
-bool TMT::DoSIAM(Result* R, double epsilon)
+void TMT::PrepareCache()
+{ //(re)allocates the cache when the number of impurities or the grid has changed
+  if ( (cache->get_Nimp() != Nimp) or (cache->get_N() != N) )
+    cache->Initialize(Nimp, N, CacheHistoryDepth);
+}
+
+void TMT::SaveState(FILE* f)
+{
+  cache->Save(f);
+}
+
+bool TMT::LoadState(FILE* f)
+{
+  return cache->Load(f);
+}
+
+unsigned long long TMT::get_RunHash()
+{
+  //disorder and the average over it, all of which drivers may set between runs
+  double p[4] = { W, GaussianCutoff, SymmetryAccr, AdaptiveAccr };
+  int q[7] = { Nimp, Distribution, Quadrature, (int) UseParticleHoleSymmetry, 
+               (int) Adaptive, AdaptiveStartLevel, AdaptiveMaxLevel };
+  return Hash(q, sizeof(q), Hash(p, sizeof(p), CHM::get_RunHash()));
+}
+
+bool TMT::DoSIAM(Result* R, double epsilon, bool KnownMPT_B, double &MPT_B)
 {
   //SIAM siam(ParamsFN.c_str());
   //SIAM siam;
   siam->SetUTepsilon(U, T, epsilon);
   siam->SetIsBethe(UseBethe);
   siam->SetBroadening(SIAMeta); 
+  if (KnownMPT_B) siam->SetInitialMPT_B(MPT_B);
   //siam.SetBroydenParameters(50, 1e-12);
 
-  return siam->Run(R);
+  bool Error = siam->Run(R);
+  MPT_B = siam->GetMPT_B();
+  return Error;
 }
 
 
@@ -181,9 +498,13 @@ void TMT::Slave(int myrank)
 
     double* epsilons = new double[Nepsilons];
     double* mu0s = new double[Nepsilons];
+    double* MPT_Bs = new double[Nepsilons];
+    int* KnownMPT_Bs = new int[Nepsilons];
     
     MPI_Recv(epsilons, Nepsilons, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD, &status);
     MPI_Recv(mu0s, Nepsilons, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD, &status);
+    MPI_Recv(MPT_Bs, Nepsilons, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD, &status);
+    MPI_Recv(KnownMPT_Bs, Nepsilons, MPI_INT, 0, 99, MPI_COMM_WORLD, &status);
 
     double* ReDelta = new double[N];
     double* ImDelta = new double[N];
@@ -199,16 +520,17 @@ void TMT::Slave(int myrank)
     bool Error = false;
     for (int i=0; i<Nepsilons; i++)
     {  
-       R[i] = new Result(grid);
+       R[i] = impurities->Get(grid);
        PrepareResult(R[i], mu, mu0s[i], ReDelta, ImDelta);
 
-       omp_set_num_threads(SiamNt);
+       ThreadTeam team(exec, Phases::Siam);
+       siam->SetNt(team.get_Nt());
        printf("PROC %d ::: ",myrank);
        //char FN[50];
        //sprintf(FN,"recieved.eps%.3f",epsilons[i]);
        //R[i]->PrintResult(FN);
        if (!Error)
-         Error = DoSIAM(R[i], epsilons[i]);
+         Error = DoSIAM(R[i], epsilons[i], KnownMPT_Bs[i], MPT_Bs[i]);
     }
 
     for (int i=0; i<Nepsilons; i++)
@@ -218,13 +540,16 @@ void TMT::Slave(int myrank)
        }
        else
          MPI_Send(&(R[i]->mu0), 1, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD);
+       MPI_Send(&(MPT_Bs[i]), 1, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD);
        MPI_Send(R[i]->DOS, N, MPI_DOUBLE, 0, 99, MPI_COMM_WORLD);
-       R[i]->~Result();
+       impurities->Release(R[i]);
     }
 
     delete [] R;
     delete [] epsilons;
     delete [] mu0s;
+    delete [] MPT_Bs;
+    delete [] KnownMPT_Bs;
     delete [] ReDelta;
     delete [] ImDelta;
 
@@ -232,24 +557,14 @@ void TMT::Slave(int myrank)
 #endif
 }
 //========================= MPI ===============================//
-bool TMT::SolveSIAM()
-{
-/*  #ifdef _MPI
-  printf("---- PARALLEL MPI\n");
-  #endif
-  
-  #ifdef _OMP
-  printf("---- PARALLEL OMP\n");
-  #endif
-*/
+bool TMT::SolveImpurities(Result** R, int Nsolve, int* List)
+{ //solves impurities in List and puts results in R
 
 #ifdef _MPI 
 
   bool Error = false;
 
   MPI_Status status;
-  
-  MakeEgrid();
 
   //r->PrintResult("initial");
 
@@ -265,11 +580,13 @@ bool TMT::SolveSIAM()
 
   printf("==== MPI ==== NUMBER OF PROCESSES: %d",Nproc); 
   
-  int Nsp = Nimp % Nproc;
-  int Nbare = Nimp / Nproc;  
+  int Nsp = Nsolve % Nproc;
+  int Nbare = Nsolve / Nproc;  
   int* Nepsilons = new int[Nproc];
   double** epsilons = new double*[Nproc];
   double** mu0s = new double*[Nproc];
+  double** MPT_Bs = new double*[Nproc];
+  int** KnownMPT_Bs = new int*[Nproc];
   
   for (int p=0; p<Nproc; p++)
   { 
@@ -277,9 +594,11 @@ bool TMT::SolveSIAM()
     if (p<=Nsp-1) Nepsilons[p]++;
     epsilons[p] = new double[Nepsilons[p]];
     mu0s[p] = new double[Nepsilons[p]];
+    MPT_Bs[p] = new double[Nepsilons[p]];
+    KnownMPT_Bs[p] = new int[Nepsilons[p]];
     for (int i=0; i<Nepsilons[p]; i++)
-    {  epsilons[p][i] = Egrid[p+i*Nproc];
-       mu0s[p][i] = mu0grid[p+i*Nproc];
+    {  epsilons[p][i] = Egrid[List[p+i*Nproc]];
+       KnownMPT_Bs[p][i] = cache->Restore(List[p+i*Nproc], mu0s[p][i], MPT_Bs[p][i], ExtrapolateWarmStart);
     }
 
     if (p!=0)
@@ -287,6 +606,8 @@ bool TMT::SolveSIAM()
        MPI_Send(&(Nepsilons[p]), 1, MPI_INT, p, 99, MPI_COMM_WORLD); 
        MPI_Send(epsilons[p], Nepsilons[p], MPI_DOUBLE, p, 99, MPI_COMM_WORLD);
        MPI_Send(mu0s[p], Nepsilons[p], MPI_DOUBLE, p, 99, MPI_COMM_WORLD);
+       MPI_Send(MPT_Bs[p], Nepsilons[p], MPI_DOUBLE, p, 99, MPI_COMM_WORLD);
+       MPI_Send(KnownMPT_Bs[p], Nepsilons[p], MPI_INT, p, 99, MPI_COMM_WORLD);
        MPI_Send(ReDelta, N, MPI_DOUBLE, p, 99, MPI_COMM_WORLD);  
        MPI_Send(ImDelta, N, MPI_DOUBLE, p, 99, MPI_COMM_WORLD);  
        MPI_Send(&U, 1, MPI_DOUBLE, p, 99, MPI_COMM_WORLD);  
@@ -296,28 +617,33 @@ bool TMT::SolveSIAM()
   }
 
   //----------- DO CALC and collect data ------------//
-  Result** R = new Result*[Nimp];
   printf("============== === === === ==== MASTER: COLLECTING DATA...\n");
   for(int p=0; p<Nproc; p++)
   {  //printf("---------- Proc %d\n",p);
      for(int i=0; i<Nepsilons[p]; i++)
      { 
-       int imp = p+i*Nproc;
+       int imp = List[p+i*Nproc];
        //printf("-------------- Imp %d\n",imp); 
-       R[imp] = new Result(*r);
+       //remote impurities return only the DOS
+       R[imp] = (p==0) ? impurities->Get(*r) : impurities->Get(r->grid);
        if (p==0)
        { //PrepareResult(R[imp], r->mu, mu0s[p][i], ReDelta, ImDelta); 
-         R[imp]->mu0 = mu0s[p][i];         
-         omp_set_num_threads(SiamNt);
+         double MPT_B;
+         bool KnownMPT_B = cache->Restore(imp, R[imp]->mu0, MPT_B, ExtrapolateWarmStart);
+         ThreadTeam team(exec, Phases::Siam);
+         siam->SetNt(team.get_Nt());
          printf("PROC 0 ::: ");
          if (!Error)
-           Error = DoSIAM(R[imp], epsilons[p][i]);
-         mu0grid[imp] = R[imp]->mu0;
+           Error = DoSIAM(R[imp], epsilons[p][i], KnownMPT_B, MPT_B);
+         cache->Store(imp, R[imp]->mu0, MPT_B);
        } 
        else
-       {
-         MPI_Recv(&(mu0grid[imp]), 1, MPI_DOUBLE, p, 99, MPI_COMM_WORLD, &status);
-         if (!Error) Error = (mu0grid[imp] == -1000.0);
+       { //the cached state is the same for remote impurities
+         double mu0, MPT_B;
+         MPI_Recv(&mu0, 1, MPI_DOUBLE, p, 99, MPI_COMM_WORLD, &status);
+         MPI_Recv(&MPT_B, 1, MPI_DOUBLE, p, 99, MPI_COMM_WORLD, &status);
+         if (!Error) Error = (mu0 == -1000.0);
+         if (mu0 != -1000.0) cache->Store(imp, mu0, MPT_B);
 
          MPI_Recv(R[imp]->DOS, N, MPI_DOUBLE, p, 99, MPI_COMM_WORLD, &status);
        }
@@ -333,58 +659,84 @@ bool TMT::SolveSIAM()
   for (int p=0; p<Nproc; p++)
   { delete [] epsilons[p];
     delete [] mu0s[p];
+    delete [] MPT_Bs[p];
+    delete [] KnownMPT_Bs[p];
   }
   delete [] epsilons;
   delete [] mu0s;
+  delete [] MPT_Bs;
+  delete [] KnownMPT_Bs;
   delete [] ReDelta;
   delete [] ImDelta;
   delete [] Nepsilons;
 
-  //------- average results---------//
-  Avarage(R);
-  r->PrintResult("Averaged");
+  return Error;
 
+#else
 
-  //----- release memory-------//
-  for (int i=0; i<Nimp; i++)
-   R[i]->~Result();
-  
-  delete [] R;
-  delete [] Egrid;
+  bool Error = false;
+
+  for (int l=0; l<Nsolve; l++)
+  {
+     int i = List[l];
+     R[i] = impurities->Get(*r);
+     double MPT_B;
+     bool KnownMPT_B = cache->Restore(i, R[i]->mu0, MPT_B, ExtrapolateWarmStart);
+
+     ThreadTeam team(exec, Phases::Siam);
+     siam->SetNt(team.get_Nt());
+     Error  = DoSIAM(R[i], Egrid[i], KnownMPT_B, MPT_B);
+        
+     cache->Store(i, R[i]->mu0, MPT_B);
+  }
 
   return Error;
 
-#else
+#endif
+}
 
+bool TMT::SolveSIAM()
+{
+/*  #ifdef _MPI
+  printf("---- PARALLEL MPI\n");
+  #endif
+  
+  #ifdef _OMP
+  printf("---- PARALLEL OMP\n");
+  #endif
+*/
   bool Error = false;
 
   MakeEgrid();
+  PrepareCache();
+  Symmetric = (UseParticleHoleSymmetry) ? IsParticleHoleSymmetric() : false;
+  if (UseParticleHoleSymmetry)
+    printf("-- INFO -- TMT: particle-hole symmetry %s\n", (Symmetric) ? "used" : "broken, solving all impurities");
 
   Result** R = new Result*[Nimp];
- 
-  for (int i=0; i<Nimp; i++)
-  {
-     R[i] = new Result(*r);
-     R[i]->mu0 = mu0grid[i];
-
-     Error  = DoSIAM(R[i], Egrid[i]);
-        
-     mu0grid[i] = R[i]->mu0;  
+  for (int i=0; i<Nimp; i++) R[i] = NULL;
+
+  if (Adaptive)
+    Error = AdaptiveSolve(R);
+  else
+  { int* Request = new int[Nimp];
+    for (int i=0; i<Nimp; i++) Request[i] = i;
+    int Nsolved = 0;
+    Error = SolveRequested(R, Nimp, Request, Nsolved);
+    delete [] Request;
   }
 
+  //------- average results---------//
   Avarage(R);
+  if (PrintAveraged) writer->Write(r, "Averaged");
 
-  // Release Memory
+  //----- release memory-------//
   for (int i=0; i<Nimp; i++)
-   R[i]->~Result(); 
+    impurities->Release(R[i]);
   delete [] R;
 
   delete [] Egrid;
+  delete [] Wgrid;
 
   return Error;
-
-#endif
 }
-
-
-
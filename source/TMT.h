@@ -4,6 +4,8 @@
 using namespace std;
 
 class Result;
+class ResultPool;
+class ImpurityCache;
 
 namespace Distributions
 {
@@ -11,6 +13,12 @@ namespace Distributions
   const int Gaussian = 1;
 }
 
+namespace Quadratures
+{
+  const int Equidistant = 0;
+  const int Gauss = 1;		//Gauss-Legendre for Uniform, Gauss-Hermite for Gaussian distribution
+}
+
 
 class TMT : public CHM
 {
@@ -18,18 +26,51 @@ class TMT : public CHM
     void Defaults();
     string ParamsFN;    
 
-    double W;
+    double W;			//box width for Uniform, standard deviation for Gaussian distribution
     int Distribution;
     int Nimp;
+    int Quadrature;
+    double GaussianCutoff;	//equidistant grid for Gaussian distribution spans [-GaussianCutoff*W, GaussianCutoff*W]
     double* Egrid;
-    double* mu0grid;
+    double* Wgrid;		//quadrature weights, sum up to 1
+
+    //--- warm start of impurities between DMFT iterations ---//
+    ImpurityCache* cache;	//mu0 and MPT_B of each impurity from previous iterations
+    int CacheHistoryDepth;
+    bool ExtrapolateWarmStart;	//linear extrapolation of mu0 and MPT_B from the last two iterations
+    void PrepareCache();
+    void SaveState(FILE* f);	//the cache is checkpointed with the loop
+    unsigned long long get_RunHash();	//also the disorder and its quadrature, adaptive and symmetry options
+    bool LoadState(FILE* f);
 
     double P(double epsilon);
     void Avarage(Result** R);
     void MakeEgrid();
 
+    //--- particle-hole symmetry ---//
+    bool UseParticleHoleSymmetry;	//if true and the problem is symmetric, only impurities with epsilon>=0 are solved
+    double SymmetryAccr;
+    bool Symmetric;			//symmetry is used in the current iteration
+    bool IsParticleHoleSymmetric();
+    int MakeSolveList(Result** R, int Nrequest, int* Request, int* List);
+    void MirrorImpurities(Result** R, int Nrequest, int* Request);
+
+    //--- solving impurities ---//
+    bool SolveImpurities(Result** R, int Nsolve, int* List);
+    bool SolveRequested(Result** R, int Nrequest, int* Request, int &Nsolved);
+
+    //--- adaptive average ---//
+    bool Adaptive;		//if true, Nimp = 2^AdaptiveMaxLevel+1 and only the needed impurities are solved
+    int AdaptiveStartLevel;
+    int AdaptiveMaxLevel;
+    double AdaptiveAccr;	//required accuracy of the typical DOS, relative to its maximum
+    double AverageError;	//error estimate of the last average
+    double IntervalError(Result** R, int a, int m, int b);
+    bool AdaptiveSolve(Result** R);
+
+    ResultPool* impurities;	//impurity Results are recycled between iterations
     void PrepareResult(Result* R, double mu, double mu0, double* ReDelta, double* ImDelta);
-    bool DoSIAM(Result* R, double epsilon);
+    bool DoSIAM(Result* R, double epsilon, bool KnownMPT_B, double &MPT_B);
 
 
     //--- OpenMP ---//
@@ -37,6 +78,7 @@ class TMT : public CHM
     int SiamNt;
     int KramarsKronigNt;
     double ExitSignal;
+    bool PrintAveraged;		//dump the averaged result on every iteration
     
   public:
     TMT();
@@ -44,7 +86,12 @@ class TMT : public CHM
     ~TMT();
 
     void SetWDN(double W, int Distribution, int Nimp);
+    void SetQuadrature(int Quadrature);
+    void SetUseParticleHoleSymmetry(bool UseParticleHoleSymmetry);
+    void SetAdaptive(bool Adaptive, int StartLevel, int MaxLevel, double Accr);
+    double get_AverageError() { return AverageError; };
     void SetUseBethe(bool UseBethe);
+    void SetTeamSizes(int AverageNt, int SiamNt, int KramarsKronigNt);
     double get_W() { return W; };
  
     bool SolveSIAM();
@@ -0,0 +1,137 @@
+#include <cstdlib>
+#include <cstring>
+#include "TextReader.h"
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+static inline bool IsBlank(char c)
+{
+  return (c == ' ') or (c == '\t') or (c == '\r');
+}
+
+TextReader::TextReader(const char* FileName)
+{
+  p = end = NULL;
+  if (file.Open(FileName))
+  { p = file.get_data();
+    end = p + file.get_size();
+  }
+}
+
+bool TextReader::AtEnd()
+{
+  const char* q = p;
+  while ( (q < end) and ( IsBlank(*q) or (*q == '\n') ) ) q++;
+  return q >= end;
+}
+
+void TextReader::SkipLine()
+{
+  while ( (p < end) and (*p != '\n') ) p++;
+  if (p < end) p++;
+}
+
+static inline bool ParseNumber(const char* &p, const char* end, double &x)
+{
+  const char* start = p;
+  if (*start == '+') start++;		//from_chars does not take a leading +
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+  std::from_chars_result res = std::from_chars(start, end, x);
+  if ( (res.ec != std::errc()) or (res.ptr == start) ) return false;
+  p = res.ptr;
+#else
+  //the mapped file is not null terminated
+  char token[64];
+  int n = 0;
+  while ( (start + n < end) and (n < 63) and (!IsBlank(start[n])) and (start[n] != '\n') ) n++;
+  memcpy(token, start, n);
+  token[n] = '\0';
+  char* stop;
+  x = strtod(token, &stop);
+  if (stop == token) return false;
+  p = start + (stop - token);
+#endif
+  return true;
+}
+
+char TextReader::Peek()
+{
+  const char* q = p;
+  while ( (q < end) and IsBlank(*q) ) q++;
+  return (q < end) ? *q : '\n';
+}
+
+bool TextReader::Read(double &x)
+{
+  while ( (p < end) and ( IsBlank(*p) or (*p == '\n') ) ) p++;
+  if (p >= end) return false;
+
+  if (!ParseNumber(p, end, x))
+  { while ( (p < end) and (!IsBlank(*p)) and (*p != '\n') ) p++;
+    return false;
+  }
+  return true;
+}
+
+int TextReader::ParseLine(const char* a, const char* b, double* row, int M)
+{
+  int n = 0;
+  while (n < M)
+  { while ( (a < b) and IsBlank(*a) ) a++;
+    if (a >= b) break;
+    if (!ParseNumber(a, b, row[n])) break;
+    n++;
+  }
+  return n;
+}
+
+double* TextReader::ReadColumns(int &N, int &M)
+{
+  N = 0;
+  M = 0;
+  int capacity = 0;
+  double* rows = NULL;		//row major while reading
+
+  while (p < end)
+  { const char* eol = (const char*) memchr(p, '\n', end - p);
+    if (eol == NULL) eol = end;
+    const char* hash = (const char*) memchr(p, '#', eol - p);
+    const char* b = (hash == NULL) ? eol : hash;
+
+    if (M == 0)
+    { //first data line defines the number of columns
+      bool InToken = false;
+      for (const char* q = p; q < b; q++)
+        if (IsBlank(*q)) InToken = false;
+        else 
+        { if (!InToken) M++;
+          InToken = true;
+        }
+    }
+
+    if (M > 0)
+    { if (N == capacity)
+      { capacity = (capacity == 0) ? 1024 : 2*capacity;
+        double* grown = new double[capacity*M];
+        if (rows != NULL) memcpy(grown, rows, N*M*sizeof(double));
+        delete [] rows;
+        rows = grown;
+      }
+      int n = ParseLine(p, b, rows + N*M, M);
+      if (n > 0)
+      { for (int j=n; j<M; j++) rows[N*M + j] = 0;
+        N++;
+      }
+    }
+    p = (eol < end) ? eol + 1 : end;
+  }
+
+  double* data = new double[N*M];
+  for (int i=0; i<N; i++)
+    for (int j=0; j<M; j++)
+      data[j*N + i] = rows[i*M + j];
+  delete [] rows;
+  return data;
+}
@@ -0,0 +1,32 @@
+//*************************************************//
+//    Parsing of numbers from a mapped text file   //
+//*************************************************//
+
+#include "MappedFile.h"
+
+class TextReader
+{
+  private:
+    MappedFile file;
+    const char* p;		//current position
+    const char* end;
+
+    int ParseLine(const char* a, const char* b, double* row, int M);	//numbers in [a,b), at most M
+
+  public:
+    TextReader(const char* FileName);
+
+    bool IsOpen() { return file.IsOpen(); };
+    bool AtEnd();		//true if only whitespace is left
+
+    void SkipLine();
+    char Peek();		//first non-blank character on the current line, '\n' if none
+    //reads the next number, skipping whitespace and line ends. returns false at the 
+    //end of the file or if the next token is not a number (the token is skipped)
+    bool Read(double &x);
+
+    //reads all remaining lines in one pass. '#' starts a comment, empty lines are skipped.
+    //the number of columns M is taken from the first data line, missing values are 0.
+    //returns a single M x N block, column j starts at data + j*N. release with delete []
+    double* ReadColumns(int &N, int &M);
+};
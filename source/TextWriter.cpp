@@ -0,0 +1,69 @@
+#include <cstring>
+#include "TextWriter.h"
+
+#if __cplusplus >= 201703L
+#include <charconv>
+#endif
+
+TextWriter::TextWriter(const char* FileName, int BufferSize)
+{
+  f = fopen(FileName, "w");
+  if (f == NULL) printf("-- ERROR -- TextWriter: can not open %s for writing\n", FileName);
+  size = (BufferSize < 256) ? 256 : BufferSize;
+  buffer = new char[size];
+  pos = 0;
+}
+
+TextWriter::~TextWriter()
+{
+  Flush();
+  if (f != NULL) fclose(f);
+  delete [] buffer;
+}
+
+void TextWriter::Flush()
+{
+  if ( (f != NULL) and (pos > 0) ) fwrite(buffer, 1, pos, f);
+  pos = 0;
+}
+
+void TextWriter::Reserve(int n)
+{
+  if (pos + n > size) Flush();
+}
+
+void TextWriter::Put(double x)
+{
+  Reserve(32);
+#if defined(__cpp_lib_to_chars) && (__cpp_lib_to_chars >= 201611L)
+  char* last = std::to_chars(buffer + pos, buffer + size, x, std::chars_format::scientific).ptr;
+  pos = last - buffer;
+#else
+  pos += snprintf(buffer + pos, size - pos, "%.17le", x);
+#endif
+}
+
+void TextWriter::Put(int i)
+{
+  Reserve(16);
+  pos += snprintf(buffer + pos, size - pos, "%d", i);
+}
+
+void TextWriter::Put(char c)
+{
+  Reserve(1);
+  buffer[pos++] = c;
+}
+
+void TextWriter::Put(const char* s)
+{
+  int n = strlen(s);
+  if (n > size)
+  { Flush();
+    if (f != NULL) fwrite(s, 1, n, f);
+    return;
+  }
+  Reserve(n);
+  memcpy(buffer + pos, s, n);
+  pos += n;
+}
@@ -0,0 +1,31 @@
+//*************************************************//
+//    Buffered text output of numbers              //
+//*************************************************//
+
+// Numbers are formatted in the shortest scientific notation that reads back to the
+// same double, into a large buffer that is written out in blocks.
+
+#include <cstdio>
+
+class TextWriter
+{
+  private:
+    FILE* f;
+    char* buffer;
+    int size;
+    int pos;
+
+    void Reserve(int n);	//makes room for n more characters
+
+  public:
+    TextWriter(const char* FileName, int BufferSize = 1<<20);
+    ~TextWriter();		//flushes and closes the file
+
+    bool IsOpen() { return f != NULL; };
+
+    void Put(double x);
+    void Put(int i);
+    void Put(char c);
+    void Put(const char* s);
+    void Flush();
+};
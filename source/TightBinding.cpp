@@ -0,0 +1,278 @@
+#include <cstdio>
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "TightBinding.h"
+#include "Input.h"
+#include "routines.h"
+
+//================== Constructors ====================//
+
+void TightBinding::Defaults()
+{
+  D = 3;
+  t[0] = t[1] = t[2] = 0.5;
+  tp = 0.0;
+  tpp = 0.0;
+  Nk = 0;	//0 - chosen by dimension
+  CacheDir = "tightbinding";
+}
+
+TightBinding::TightBinding()
+{
+  Defaults();
+}
+
+TightBinding::TightBinding(const char* ParamsFN)
+{
+  Defaults();
+  Input input(ParamsFN);
+  input.ReadParam(D, "TB::D");
+  if ( (D < 1) or (D > 3) ) { printf("-- ERROR -- TightBinding: D = %d not supported\n", D); exit(1); }
+  input.ReadArray(D, t, "TB::t");
+  for (int a=D; a<3; a++) t[a] = 0.0;
+  input.ReadParam(tp, "TB::tp");
+  input.ReadParam(tpp, "TB::tpp");
+  input.ReadParam(Nk, "TB::Nk");
+  input.ReadParam(CacheDir, "TB::CacheDir");
+}
+
+void TightBinding::SetDispersion(int D, const double* t, double tp, double tpp)
+{
+  this->D = D;
+  for (int a=0; a<3; a++) this->t[a] = (a < D) ? t[a] : 0.0;
+  this->tp = tp;
+  this->tpp = tpp;
+}
+
+void TightBinding::SetNk(int Nk)
+{
+  this->Nk = Nk;
+}
+
+void TightBinding::SetCacheDir(const char* CacheDir)
+{
+  this->CacheDir.assign(CacheDir);
+}
+
+double TightBinding::get_HalfBandwidth()
+{
+  double w = 0;
+  for (int a=0; a<D; a++) w += 2*abs(t[a]) + 2*abs(tpp);
+  return w + 4*abs(tp) * D*(D-1)/2;
+}
+
+//================== Dispersion ====================//
+
+void TightBinding::get_Dispersion(double* eps)
+{ //cosines are tabulated per axis, axes beyond D have zero cosines
+  double* c = new double[3*Nk];
+  double* c2 = new double[3*Nk];
+  for (int a=0; a<3; a++)
+    for (int i=0; i<Nk; i++)
+    { c[a*Nk + i] = (a < D) ? cos(2*pi*i/Nk) : 0.0;
+      c2[a*Nk + i] = (a < D) ? cos(4*pi*i/Nk) : 0.0;
+    }
+  int Ny = (D > 1) ? Nk : 1;
+  int Nz = (D > 2) ? Nk : 1;
+
+  #pragma omp parallel for collapse(2)
+  for (int iz=0; iz<Nz; iz++)
+    for (int iy=0; iy<Ny; iy++)
+    { double cy = c[Nk + iy], cz = c[2*Nk + iz];
+      double base = - 2*(t[1]*cy + t[2]*cz) - 4*tp*cy*cz - 2*tpp*(c2[Nk + iy] + c2[2*Nk + iz]);
+      double cx_coef = 2*t[0] + 4*tp*(cy + cz);
+      double* row = eps + (long) (iz*Ny + iy) * Nk;
+      #pragma omp simd
+      for (int ix=0; ix<Nk; ix++)
+        row[ix] = base - cx_coef * c[ix] - 2*tpp*c2[ix];
+    }
+
+  delete [] c;
+  delete [] c2;
+}
+
+//================== Tetrahedron integration ====================//
+
+namespace
+{
+  //each simplex adds its DOS, normalized to weight, at the omega points inside its energy range
+
+  inline void AddSegment(int N, double* omega, double* dos, double weight, double e1, double e2)
+  {
+    if (e1 > e2) swap(e1, e2);
+    if (e2 <= e1) return;
+    double g = weight / (e2 - e1);
+    for (int i = lower_bound(omega, omega+N, e1) - omega; (i < N) and (omega[i] < e2); i++)
+      dos[i] += g;
+  }
+
+  inline void AddTriangle(int N, double* omega, double* dos, double weight, double* e)
+  {
+    sort(e, e+3);
+    double e21 = e[1]-e[0], e31 = e[2]-e[0], e32 = e[2]-e[1];
+    for (int i = lower_bound(omega, omega+N, e[0]) - omega; (i < N) and (omega[i] < e[2]); i++)
+    { double E = omega[i];
+      if (E <= e[0]) continue;
+      if (E < e[1]) dos[i] += weight * 2*(E - e[0]) / (e21*e31);
+      else dos[i] += weight * 2*(e[2] - E) / (e31*e32);
+    }
+  }
+
+  inline void AddTetrahedron(int N, double* omega, double* dos, double weight, double* e)
+  { //Bloechl, Jepsen and Andersen, PRB 49, 16223 (1994)
+    sort(e, e+4);
+    double e21 = e[1]-e[0], e31 = e[2]-e[0], e41 = e[3]-e[0];
+    double e32 = e[2]-e[1], e42 = e[3]-e[1], e43 = e[3]-e[2];
+    for (int i = lower_bound(omega, omega+N, e[0]) - omega; (i < N) and (omega[i] < e[3]); i++)
+    { double E = omega[i];
+      if (E <= e[0]) continue;
+      double g;
+      if (E < e[1]) g = 3*sqr(E - e[0]) / (e21*e31*e41);
+      else if (E < e[2]) g = ( 3*e21 + 6*(E - e[1]) - 3*(e31 + e42)*sqr(E - e[1]) / (e32*e42) ) / (e31*e41);
+      else g = 3*sqr(e[3] - E) / (e41*e42*e43);
+      dos[i] += weight * g;
+    }
+  }
+
+  //cubes are split into 6 tetrahedra along the main diagonal, corner c = x + 2y + 4z
+  const int Tetrahedra[6][4] = { {0,1,3,7}, {0,1,5,7}, {0,2,3,7}, {0,2,6,7}, {0,4,5,7}, {0,4,6,7} };
+}
+
+void TightBinding::Integrate(int N, double* omega, double* eps, double* dos)
+{
+  for (int i=0; i<N; i++) dos[i] = 0.0;
+
+  //slices along the last axis are shared among threads, each with its own DOS
+  int Nslices = Nk;
+  #pragma omp parallel
+  {
+    double* local = new double[N];
+    for (int i=0; i<N; i++) local[i] = 0.0;
+
+    #pragma omp for schedule(dynamic)
+    for (int s=0; s<Nslices; s++)
+    { int s1 = (s + 1) % Nk;
+      if (D == 1)
+        AddSegment(N, omega, local, 1.0/Nk, eps[s], eps[s1]);
+      if (D == 2)
+        for (int ix=0; ix<Nk; ix++)
+        { int ix1 = (ix + 1) % Nk;
+          double e[3];
+          double w = 0.5 / (Nk*Nk);
+          e[0] = eps[s*Nk + ix]; e[1] = eps[s*Nk + ix1]; e[2] = eps[s1*Nk + ix1];
+          AddTriangle(N, omega, local, w, e);
+          e[0] = eps[s*Nk + ix]; e[1] = eps[s1*Nk + ix]; e[2] = eps[s1*Nk + ix1];
+          AddTriangle(N, omega, local, w, e);
+        }
+      if (D == 3)
+        for (int iy=0; iy<Nk; iy++)
+          for (int ix=0; ix<Nk; ix++)
+          { int iy1 = (iy + 1) % Nk, ix1 = (ix + 1) % Nk;
+            double corner[8];
+            for (int c=0; c<8; c++)
+              corner[c] = eps[ ( (long) ((c & 4) ? s1 : s) * Nk + ((c & 2) ? iy1 : iy) ) * Nk + ((c & 1) ? ix1 : ix) ];
+            double w = 1.0 / (6.0 * Nk*Nk*Nk);
+            for (int k=0; k<6; k++)
+            { double e[4];
+              for (int v=0; v<4; v++) e[v] = corner[ Tetrahedra[k][v] ];
+              AddTetrahedron(N, omega, local, w, e);
+            }
+          }
+    }
+
+    #pragma omp critical
+    for (int i=0; i<N; i++) dos[i] += local[i];
+    delete [] local;
+  }
+}
+
+//================== Cache ====================//
+
+struct TightBindingHeader
+{
+  char magic[8];
+  int version;
+  int D;
+  int Nk;
+  int N;
+  double t[3];
+  double tp;
+  double tpp;
+};
+
+bool TightBinding::ReadCache(const char* FN, int N, double* omega, double* dos)
+{
+  FILE* f = fopen(FN, "rb");
+  if (f == NULL) return false;
+  TightBindingHeader H;
+  bool ok = (fread(&H, sizeof(H), 1, f) == 1)
+            and (memcmp(H.magic, TightBindingFile::Magic, 8) == 0) and (H.version == TightBindingFile::Version)
+            and (H.D == D) and (H.Nk == Nk) and (H.N == N) and (H.tp == tp) and (H.tpp == tpp)
+            and (memcmp(H.t, t, sizeof(t)) == 0);
+  if (ok)
+  { double* w = new double[N];
+    ok = (fread(w, sizeof(double), N, f) == (size_t) N) and (memcmp(w, omega, N*sizeof(double)) == 0)
+         and (fread(dos, sizeof(double), N, f) == (size_t) N);
+    delete [] w;
+  }
+  fclose(f);
+  return ok;
+}
+
+void TightBinding::WriteCache(const char* FN, int N, double* omega, double* dos)
+{ //written under a private name and renamed, as the lattice tables
+  TightBindingHeader H;
+  memset(&H, 0, sizeof(H));
+  memcpy(H.magic, TightBindingFile::Magic, 8);
+  H.version = TightBindingFile::Version;
+  H.D = D;
+  H.Nk = Nk;
+  H.N = N;
+  memcpy(H.t, t, sizeof(t));
+  H.tp = tp;
+  H.tpp = tpp;
+
+  mkdir(CacheDir.c_str(), 0755);
+  char tmpFN[400];
+  snprintf(tmpFN, 400, "%s.tmp.%d", FN, (int) getpid());
+  FILE* f = fopen(tmpFN, "wb");
+  bool ok = (f != NULL);
+  if (ok)
+  { ok = (fwrite(&H, sizeof(H), 1, f) == 1)
+         and (fwrite(omega, sizeof(double), N, f) == (size_t) N)
+         and (fwrite(dos, sizeof(double), N, f) == (size_t) N);
+    ok = (fclose(f) == 0) and ok;
+    ok = ok and (rename(tmpFN, FN) == 0);
+  }
+  if (!ok) printf("-- WARNING -- TightBinding: can not write %s\n", FN);
+}
+
+//================== DOS and G ====================//
+
+void TightBinding::get_DOS(int N, double* omega, double* dos)
+{
+  if (Nk <= 0) Nk = (D == 3) ? 64 : (D == 2) ? 1024 : 65536;
+
+  char FN[400];
+  snprintf(FN, 400, "%s/tb.D%d.t%.6f_%.6f_%.6f.tp%.6f.tpp%.6f.Nk%d.N%d",
+           CacheDir.c_str(), D, t[0], t[1], t[2], tp, tpp, Nk, N);
+  if ( (CacheDir != "") and ReadCache(FN, N, omega, dos) ) return;
+
+  long Nmesh = (long) Nk * ( (D > 1) ? Nk : 1 ) * ( (D > 2) ? Nk : 1 );
+  double* eps = new double[Nmesh];
+  get_Dispersion(eps);
+  Integrate(N, omega, eps, dos);
+  delete [] eps;
+
+  printf("-- INFO -- TightBinding: D=%d t=(%.3f,%.3f,%.3f) tp=%.3f tpp=%.3f, weight of the DOS: %.6f\n",
+         D, t[0], t[1], t[2], tp, tpp, TrapezIntegral(N, dos, omega));
+  if (CacheDir != "") WriteCache(FN, N, omega, dos);
+}
+
+void TightBinding::get_G(int N, double* omega, double* dos, complex<double>* G)
+{
+  HilbertTransform(N, omega, dos, 0.0, G);
+}
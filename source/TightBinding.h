@@ -0,0 +1,51 @@
+//*************************************************//
+//    DOS of tight-binding lattices                //
+//*************************************************//
+
+// Hypercubic lattices in D = 1, 2, 3 with (anisotropic) nearest neighbour hopping t[a],
+// next-nearest (diagonal) hopping tp and third neighbour hopping tpp along the axes:
+//   eps(k) = - 2 sum_a t[a] cos k_a - 4 tp sum_{a<b} cos k_a cos k_b - 2 tpp sum_a cos 2k_a
+// The DOS is computed on any omega grid by linear tetrahedron (triangle in 2D, segment
+// in 1D) integration over an Nk^D mesh, in parallel over k-slices, and cached under
+// CacheDir. The Hilbert transform of the DOS gives the lattice G.
+
+#include <complex>
+#include <string>
+
+using namespace std;
+
+namespace TightBindingFile
+{
+  const char Magic[8] = {'D','M','F','T','T','B','D','S'};
+  const int Version = 1;
+}
+
+class TightBinding
+{
+  private:
+    void Defaults();
+
+    int D;		//dimension
+    double t[3];	//nearest neighbour hopping along each axis
+    double tp;		//next-nearest neighbour
+    double tpp;		//third neighbour
+    int Nk;		//k-points per axis
+    string CacheDir;
+
+    void get_Dispersion(double* eps);	//on the whole mesh, Nk^D values
+    void Integrate(int N, double* omega, double* eps, double* dos);
+    bool ReadCache(const char* FN, int N, double* omega, double* dos);
+    void WriteCache(const char* FN, int N, double* omega, double* dos);
+
+  public:
+    TightBinding();
+    TightBinding(const char* ParamsFN);
+
+    void SetDispersion(int D, const double* t, double tp, double tpp);
+    void SetNk(int Nk);
+    void SetCacheDir(const char* CacheDir);	//"" for no caching
+
+    double get_HalfBandwidth();		//bound on |eps|
+    void get_DOS(int N, double* omega, double* dos);	//omega ascending
+    void get_G(int N, double* omega, double* dos, complex<double>* G);	//retarded, from the DOS
+};
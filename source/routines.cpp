@@ -1,6 +1,11 @@
 #include "routines.h"
 #include "GRID.h"
+#include "TextWriter.h"
+#include "TextReader.h"
+#include "LatticeTable.h"
 #include <vector>
+#include <algorithm>
+#include <cstring>
 #include <omp.h>
 
 using namespace std;
@@ -29,6 +34,58 @@ complex<double> sqr(complex<double> x)
  return x*x;
 }
 
+//--- fermi function ---//
+
+namespace
+{
+  //exp(x) for x <= 0 as 2^n exp(r), |r| <= ln2/2, with the Taylor series of exp(r) to r^12.
+  //No branches or library calls, so that loops over it vectorize. Below -708 the result is
+  //clamped to exp(-708) instead of going through denormals.
+  #pragma omp declare simd
+  inline double ExpNonPositive(double x)
+  {
+    const double Shift = 6755399441055744.0;	//1.5 * 2^52, rounds to nearest integer
+    x = (x < -708.0) ? -708.0 : x;
+    double t = x * 1.4426950408889634 + Shift;
+    double n = t - Shift;
+    double r = x - n * 6.93147180369123816490e-01 - n * 1.90821492927058770002e-10;
+    double p = 1.0/479001600.0;
+    p = p * r + 1.0/39916800.0;
+    p = p * r + 1.0/3628800.0;
+    p = p * r + 1.0/362880.0;
+    p = p * r + 1.0/40320.0;
+    p = p * r + 1.0/5040.0;
+    p = p * r + 1.0/720.0;
+    p = p * r + 1.0/120.0;
+    p = p * r + 1.0/24.0;
+    p = p * r + 1.0/6.0;
+    p = p * r + 0.5;
+    p = p * r + 1.0;
+    p = p * r + 1.0;
+    long long bits = ( (long long) n + 1023 ) << 52;
+    double scale;
+    memcpy(&scale, &bits, 8);
+    return p * scale;
+  }
+}
+
+double Fermi(double omega, double T)
+{ //exp of a non-positive argument only, so that omega/T can be large
+  double x = omega / T;
+  double e = ExpNonPositive( - abs(x) );
+  return (x > 0) ? e / (1.0 + e) : 1.0 / (1.0 + e);
+}
+
+void Fermi(int N, const double* omega, double T, double* f)
+{
+  #pragma omp parallel for simd schedule(static)
+  for (int i=0; i<N; i++)
+  { double x = omega[i] / T;
+    double e = ExpNonPositive( - abs(x) );
+    f[i] = (x > 0) ? e / (1.0 + e) : 1.0 / (1.0 + e);
+  }
+}
+
 /*double abs(double x)
 {
   return (x>=0) ? x : -x; 
@@ -42,127 +99,113 @@ complex<double> sqr(complex<double> x)
 
 void PrintFunc3D(const char* FileName, int N, complex<double>** Y, double* X)          
 { 
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i+=20)
     for (int j=0; j<N; j+=20)
-      fprintf(f,"%.15le %.15le %.15le %.15le\n", X[i], X[j], real(Y[i][j]), imag(Y[i][j]));
-  fclose(f);
+    { f.Put(X[i]); f.Put(' ');
+      f.Put(X[j]); f.Put(' ');
+      f.Put(real(Y[i][j])); f.Put(' ');
+      f.Put(imag(Y[i][j])); f.Put('\n');
+    }
 }
 
 void PrintFunc(const char* FileName, int N, int M, double** Y, double* X)
 { 
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i++)   
   { 
-    fprintf(f, "%.15le", X[i]);
+    f.Put(X[i]);
     for (int j=0; j<M; j++)
-    { 
-       // loop through and store the numbers into the file
-       fprintf(f, "%.15le", Y[i][j] );
+    { f.Put(' ');
+      f.Put(Y[i][j]);
     }
-   fprintf(f, "\n");
+    f.Put('\n');
   }
-  fclose(f);
 }
 
 void PrintFunc(const char* FileName, int N, complex<double>* Y, double* X)          
 { 
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i++)
-    fprintf(f,"%.15le %.15le %.15le\n", X[i], real(Y[i]), imag(Y[i]));
-  fclose(f);
+  { f.Put(X[i]); f.Put(' ');
+    f.Put(real(Y[i])); f.Put(' ');
+    f.Put(imag(Y[i])); f.Put('\n');
+  }
 }
 
 void PrintFunc(const char* FileName, int N, complex<double>* Y)
 {  
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i++)
-    fprintf(f,"%d %.15le %.15le\n", i, real(Y[i]), imag(Y[i]));
-  fclose(f);
+  { f.Put(i); f.Put(' ');
+    f.Put(real(Y[i])); f.Put(' ');
+    f.Put(imag(Y[i])); f.Put('\n');
+  }
 }
 
 void PrintFunc(const char* FileName, int N, double* Y)
 {
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i++)
-    fprintf(f,"%d %.15le \n", i, Y[i]);
-  fclose(f);
+  { f.Put(i); f.Put(' ');
+    f.Put(Y[i]); f.Put(" \n");
+  }
 }
 
 
 void PrintFunc(const char* FileName, int N, double* Y, double* X)
 { 
-  FILE *f;
-  f = fopen(FileName, "w");
+  TextWriter f(FileName);
   for (int i=0; i<N; i++)  
-    fprintf(f,"%.15le %.15le\n", X[i], Y[i]);
-  fclose(f);
+  { f.Put(X[i]); f.Put(' ');
+    f.Put(Y[i]); f.Put('\n');
+  }
 }
 
 void PrintFunc(const char* FileName, std::vector< complex<double> > Y, std::vector<double> X)          
 { 
-  FILE *f;
-  f = fopen(FileName, "w");
-  for (int i=0; i<X.size(); i++)
-    fprintf(f,"%.15le %.15le %.15le\n", X[i], real(Y[i]), imag(Y[i]));
-  fclose(f);
-}
-
-void GetDimensions(const char* FileName, int &N, int &M)
-{
- //----open file---//
-  FILE *f;
-  f = fopen(FileName, "r");
-  if (f==NULL) perror ("Error opening file");
-    
-  //----count rows----//
-  int i=0;
-  char str[1000];
-  while (!feof(f))
-  {
-    fgets ( str, 1000, f );
-    i++;
-  }
-  N=i-1;
-
-  //----count columns---//
-  i=1;
-  int j=0;
-  while (str[i] != '\0')
-  {  if ((str[i]!=' ')and(str[i-1]==' ')) j++;
-     i++;
-  }                     
-  M=j+1;
-                            
-  //---close file-----//
-  fclose(f);
-}
-                              
+  TextWriter f(FileName);
+  for (size_t i=0; i<X.size(); i++)
+  { f.Put(X[i]); f.Put(' ');
+    f.Put(real(Y[i])); f.Put(' ');
+    f.Put(imag(Y[i])); f.Put('\n');
+  }
+}
+
 void ReadFunc(const char* FileName, int &N, int &M, double** &X)
-{
- GetDimensions(FileName, N, M);
- printf("N: %d M: %d\n", N, M);
+{ //X[j] is column j, all columns are in one block. release with ReleaseFunc
+  TextReader f(FileName);
+  if (!f.IsOpen()) perror ("Error opening file");
 
- X = new double*[M];
- for (int i=0; i<M; i++)
-   X[i] = new double[N];
+  double* data = f.ReadColumns(N, M);
+  printf("N: %d M: %d\n", N, M);
 
- FILE *f;
- f = fopen(FileName, "r");
+  X = new double*[(M>0) ? M : 1];
+  X[0] = data;
+  for (int j=1; j<M; j++)
+    X[j] = data + j*N;
+}
 
- for (int i=0; i<N; i++)
-   for (int j=0; j<M; j++)
-   { double Dummy;
-     fscanf(f, "%le", &Dummy);
-     X[j][i]=Dummy;
-   }
- fclose(f);
- printf("uchito fajl");
+void ReleaseFunc(double** X)
+{
+  delete [] X[0];
+  delete [] X;
+}
+
+void Resample(int n, double* Y, double* X, int N, double* x, double* y)
+{ //linear interpolation of (X,Y) at points x, 0 outside [X[0],X[n-1]]. X must be ascending.
+  //for ascending x a single sweep through both arrays is done
+  int j = 0;
+  for (int i=0; i<N; i++)
+  { if ( (x[i] < X[0]) or (x[i] > X[n-1]) or (n < 2) ) 
+    { y[i] = 0;
+      continue;
+    }
+    if ( (i > 0) and (x[i] < x[i-1]) ) 
+      j = min( (int) (upper_bound(X, X+n, x[i]) - X - 1), n-2 );	//x[i] == X[n-1] gives n-1
+    while ( (j < n-2) and (X[j+1] <= x[i]) ) j++;
+    y[i] = Y[j] + (Y[j+1]-Y[j]) / (X[j+1]-X[j]) * (x[i]-X[j]);
+  }
 }
 //---------------- vectors and matrices--------------------//
 
@@ -210,62 +253,78 @@ void RotateVector2D(double* v, double angle)
                                 
 //------------------ integral routine ---------------------//
 
-double TrapezIntegralMP(int N, double Y[], double X[])
-{
-#ifdef _OMP
- 
-  double sum = 0.0;
-  sum += Y[0]*(X[1]-X[0]) + Y[N-1]*(X[N-1]-X[N-2]);
-  int Nt;
-  double* psum = new double[8];
-  #pragma omp parallel shared(psum)
-  { Nt = omp_get_num_threads();
-    int tid = omp_get_thread_num();
-    psum[tid] = 0; 
-    for (int i=tid+1; i<N-1; i+=Nt)
-      psum[tid]+=Y[i]*(X[i+1]-X[i-1]);
-    //printf("inside proc %d, psum = %le\n",tid,psum[tid]);
-  }
-  for (int i = 0; i<Nt; i++) 
-  {  sum += psum[i];
-     //printf("outside proc %d, psum = %le\n",i,psum[i]);
-  }
-  delete [] psum;
-  return sum*0.5;
-
-#else
+//---- weighted sums: fixed blocks are summed in parallel and the block sums in order,
+//     so the result does not depend on the number of threads ----//
 
-  return TrapezIntegral(N,Y,X);
+const int SumBlock = 2048;
 
-#endif
+void TrapezWeights(int N, double* X, double* w)
+{
+  w[0] = 0.5 * (X[1] - X[0]);
+  w[N-1] = 0.5 * (X[N-1] - X[N-2]);
+  for (int i=1; i<N-1; i++) w[i] = 0.5 * (X[i+1] - X[i-1]);
 }
 
-complex<double> TrapezIntegralMP(int N, complex<double> Y[], double X[])
+double WeightedSum(int N, const double* w, const double* Y)
 {
+  int Nblocks = (N + SumBlock - 1) / SumBlock;
+  double* partial = new double[Nblocks];
+  #pragma omp parallel for schedule(static) if ( (Nblocks > 1) and (!omp_in_parallel()) )
+  for (int b=0; b<Nblocks; b++)
+  { int end = min(N, (b+1)*SumBlock);
+    double sum = 0.0;
+    #pragma omp simd reduction(+:sum)
+    for (int i=b*SumBlock; i<end; i++) sum += w[i] * Y[i];
+    partial[b] = sum;
+  }
+  double sum = 0.0;
+  for (int b=0; b<Nblocks; b++) sum += partial[b];
+  delete [] partial;
+  return sum;
+}
 
-#ifdef _OMP
-  
-  complex<double> sum = 0.0;
-  sum += Y[0]*(X[1]-X[0]) + Y[N-1]*(X[N-1]-X[N-2]);
-  int Nt;
-  complex<double>* psum = new complex<double>[8];
-  #pragma omp parallel shared(psum)
-  { Nt = omp_get_num_threads();
-    int tid = omp_get_thread_num();
-    psum[tid] = 0; 
-    for (int i=tid+1; i<N-1; i+=Nt)
-      psum[tid]+=Y[i]*(X[i+1]-X[i-1]);
-  }
-  for (int i = 0; i<Nt; i++) sum += psum[i];
-  delete [] psum;
-  return sum*0.5;
-
-#else
-
-  return TrapezIntegral(N,Y,X);
+complex<double> WeightedSum(int N, const double* w, const complex<double>* Y)
+{
+  const double* y = (const double*) Y;	//interleaved real and imaginary parts
+  int Nblocks = (N + SumBlock - 1) / SumBlock;
+  double* partial = new double[2*Nblocks];
+  #pragma omp parallel for schedule(static) if ( (Nblocks > 1) and (!omp_in_parallel()) )
+  for (int b=0; b<Nblocks; b++)
+  { int end = min(N, (b+1)*SumBlock);
+    double re = 0.0, im = 0.0;
+    #pragma omp simd reduction(+:re,im)
+    for (int i=b*SumBlock; i<end; i++)
+    { re += w[i] * y[2*i];
+      im += w[i] * y[2*i+1];
+    }
+    partial[2*b] = re;
+    partial[2*b+1] = im;
+  }
+  double re = 0.0, im = 0.0;
+  for (int b=0; b<Nblocks; b++)
+  { re += partial[2*b];
+    im += partial[2*b+1];
+  }
+  delete [] partial;
+  return complex<double>(re, im);
+}
 
-#endif
+double TrapezIntegralMP(int N, double Y[], double X[])
+{
+  double* w = new double[N];
+  TrapezWeights(N, X, w);
+  double sum = WeightedSum(N, w, Y);
+  delete [] w;
+  return sum;
+}
 
+complex<double> TrapezIntegralMP(int N, complex<double> Y[], double X[])
+{
+  double* w = new double[N];
+  TrapezWeights(N, X, w);
+  complex<double> sum = WeightedSum(N, w, Y);
+  delete [] w;
+  return sum;
 }
 
 double TrapezIntegral(int N, double Y[], double X[])
@@ -312,51 +371,256 @@ complex<double> TrapezIntegral(int N, complex<double> Y[], double X[])
   return sum*complex<double>(0.5);
 }
 
-double EllipticIntegralFirstKind(double x)
-{ //integration goes from 0 to 1
-  //split integration interval
-  int Nlog=1000;
-  int Nlin=1000;
-  int N = Nlog+Nlin;
-  double* omega = new double[N];
-  GRID grid(Nlog,Nlin,1.0,1.0e-1,1.0e-6);
-  grid.assign_omega(omega);
+//---- arithmetic-geometric mean, converges quadratically ----//
 
-  double* integrand = new double[N];  
-  for (int i=N/2; i<N; i++) integrand[i] = 0;
-  for (int i=0; i<N/2; i++) integrand[i] = 1.0 / sqrt( (1-sqr(omega[i]+1.0))*(1-sqr((omega[i]+1.0)*x))  );
-  
-  double res = TrapezIntegral(N,integrand,omega);
-  delete [] integrand;
-  delete [] omega;
-  return res;
+double AGM(double a, double b)
+{
+  for (int n=0; n<64; n++)
+  { double an = 0.5*(a+b);
+    b = sqrt(a*b);
+    a = an;
+    if (abs(a-b) <= 1e-15*abs(a)) break;
+  }
+  return 0.5*(a+b);
+}
+
+complex<double> AGM(complex<double> a, complex<double> b)
+{ //the root closer to the arithmetic mean is taken on each step, which gives
+  //the analytic continuation of the real AGM
+  for (int n=0; n<64; n++)
+  { complex<double> an = 0.5*(a+b);
+    complex<double> bn = sqrt(a*b);
+    if (abs(an-bn) > abs(an+bn)) bn = -bn;
+    a = an;
+    b = bn;
+    if (abs(a-b) <= 1e-15*abs(a)) break;
+  }
+  return 0.5*(a+b);
+}
+
+double EllipticIntegralFirstKind(double x)
+{ //K(x) = int_0^1 dt / sqrt( (1-t^2)(1-x^2 t^2) ) = pi / ( 2 AGM(1, sqrt(1-x^2)) )
+  return 0.5 * pi / AGM(1.0, sqrt(1.0 - x*x));
 }
 
 complex<double> EllipticIntegralFirstKind(complex<double> x)
-{ //integration goes from 0 to 1
-  //split integration interval
-  int Nlog=3000;
-  int Nlin=3000;
-  int N = Nlog+Nlin;
-  double* omega = new double[N];
-  GRID grid(Nlog,Nlin,1.0,1.0e-1,1.0e-14);
-  grid.assign_omega(omega);
+{ //same as above, principal branch with a cut for real x^2 > 1
+  return 0.5 * pi / AGM(complex<double>(1.0), sqrt(1.0 - x*x));
+}
+
+//---- Faddeeva function w(z) = exp(-z^2) erfc(-iz), for Im z >= 0 ----//
+
+namespace
+{ //rational expansion of J.A.C. Weideman, SIAM J. Numer. Anal. 31, 1497 (1994)
+  const int FaddeevaN = 32;
+
+  struct FaddeevaCoefficients
+  { double L;
+    double a[FaddeevaN+1];
+
+    FaddeevaCoefficients()
+    { //a_n = 1/2M sum_k f(k) cos(pi n k / M), f(k) = exp(-t^2)(L^2+t^2), t = L tan(pi k / 2M)
+      int M = 2*FaddeevaN;
+      L = sqrt( FaddeevaN / sqrt(2.0) );
+      a[0] = 0;
+      for (int n=1; n<=FaddeevaN; n++)
+      { double sum = 0;
+        for (int k=-M+1; k<M; k++)
+        { double t = L * tan( 0.5 * k * pi / M );
+          sum += exp(-t*t) * (L*L + t*t) * cos( pi * n * k / M );
+        }
+        a[n] = sum / (2*M);
+      }
+    }
+  };
+}
 
-  complex<double>* integrand = new complex<double>[N];  
-  for (int i=N/2; i<N; i++) integrand[i] = 0;
-  for (int i=0; i<N/2; i++) integrand[i] = 1.0 / (sqrt( complex<double> ( (1.0 - sqr(omega[i]+1.0))
-                                                                              * ( 1.0 - sqr((omega[i]+1.0)*x) )
-                                                                         )
-                                                       )
-                                                  );
-//  /*char FN[50];
-//  sprintf(FN,"elliptic.x%.3f",real(x));
-//  PrintFunc(FN,N, integrand, omega);
-  complex<double> res = TrapezIntegral(N,integrand,omega);
-  delete [] integrand;
-  delete [] omega;
-  grid.~GRID();
-  return res;
+complex<double> Faddeeva(complex<double> z)
+{
+  static const FaddeevaCoefficients c;	//initialized once, also with OpenMP
+  complex<double> d = c.L - complex<double>(0.0, 1.0) * z;
+  complex<double> Z = (c.L + complex<double>(0.0, 1.0) * z) / d;
+  complex<double> p = 0.0;
+  for (int n=FaddeevaN; n>=1; n--) p = p * Z + c.a[n];
+  return 2.0 * p / sqr(d) + 1.0 / (sqrt(pi) * d);
+}
+
+//---- digamma function psi(z) = Gamma'(z)/Gamma(z), z not on the non-positive real axis ----//
+
+complex<double> Digamma(complex<double> z)
+{
+  if (imag(z) < 0) return conj( Digamma( conj(z) ) );
+  if (real(z) < 0.5)
+  { //reflection, psi(z) = psi(1-z) - pi cot(pi z), cot through q = exp(2 pi i z), |q| <= 1
+    complex<double> q = exp( complex<double>(0.0, 2*pi) * z );
+    return Digamma(1.0 - z) - pi * complex<double>(0.0, 1.0) * (q + 1.0) / (q - 1.0);
+  }
+  complex<double> shift = 0.0;
+  for (; real(z) < 10.0; z += 1.0) shift -= 1.0 / z;
+  //asymptotic series in 1/z^2 with Bernoulli numbers, the next term is below 1e-16
+  complex<double> r = 1.0 / (z*z);
+  complex<double> p = r * ( -1.0/12 + r * ( 1.0/120 + r * ( -1.0/252 + r * ( 1.0/240
+                      + r * ( -1.0/132 + r * ( 691.0/32760 + r * ( -1.0/12 ) ) ) ) ) ) );
+  return shift + log(z) - 0.5 / z + p;
+}
+
+//---- radix-2 FFT, in place, N a power of 2, unnormalized ----//
+
+void FFT(int N, complex<double>* a, bool inverse)
+{
+  for (int i=1, j=0; i<N; i++)
+  { int bit = N >> 1;
+    for (; j & bit; bit >>= 1) j ^= bit;
+    j ^= bit;
+    if (i < j) swap(a[i], a[j]);
+  }
+  for (int len=2; len<=N; len <<= 1)
+  { double angle = 2*pi/len * ( (inverse) ? 1 : -1 );
+    complex<double> wlen(cos(angle), sin(angle));
+    for (int i=0; i<N; i+=len)
+    { complex<double> w = 1.0;
+      for (int j=0; j<len/2; j++)
+      { complex<double> u = a[i+j];
+        complex<double> v = a[i+j+len/2] * w;
+        a[i+j] = u + v;
+        a[i+j+len/2] = u - v;
+        w *= wlen;
+      }
+    }
+  }
+}
+
+//---- G(x) = int de dos(e) / (x - e + i0) at x = omega[i] + shift, in O(M log M) ----//
+
+void HilbertTransform(int N, double* omega, double* dos, double shift, complex<double>* G)
+{ //dos is resampled to M uniform cells of width h covering the grid and the shift. In
+  //   ReG_k = h sum_{j!=k} (D_j - D_k) / (e_k - e_j) - h D'_k + D_k log( (e_k - a) / (b - e_k) )
+  //the sum over D_j is a convolution with 1/(k-j), done by FFT, the one over D_k gives
+  //harmonic numbers and the log is the integral of the singular part over [a,b]
+  double a = omega[0] - abs(shift);
+  double b = omega[N-1] + abs(shift);
+  int M = 1;
+  while (M < 4*N) M *= 2;
+  int L = 2*M;
+  double h = (b - a) / M;
+
+  double* e = new double[M];
+  double* D = new double[M];
+  for (int k=0; k<M; k++) e[k] = a + (k + 0.5) * h;
+  Resample(N, dos, omega, M, e, D);
+
+  complex<double>* f = new complex<double>[L];
+  complex<double>* kernel = new complex<double>[L];
+  for (int k=0; k<L; k++)
+  { f[k] = (k < M) ? D[k] : 0.0;
+    kernel[k] = 0.0;
+  }
+  for (int m=1; m<M; m++)
+  { kernel[m] = 1.0 / m;
+    kernel[L-m] = -1.0 / m;
+  }
+  FFT(L, f, false);
+  FFT(L, kernel, false);
+  for (int k=0; k<L; k++) f[k] *= kernel[k];
+  FFT(L, f, true);
+
+  double* ReG = new double[M];
+  double* H = new double[M];	//harmonic numbers
+  H[0] = 0;
+  for (int k=1; k<M; k++) H[k] = H[k-1] + 1.0 / k;
+  #pragma omp parallel for
+  for (int k=0; k<M; k++)
+  { double dD = (k == 0) ? D[1] - D[0] : (k == M-1) ? D[M-1] - D[M-2] : 0.5 * (D[k+1] - D[k-1]);
+    ReG[k] = real(f[k]) / L - D[k] * (H[k] - H[M-1-k]) - dD
+             + D[k] * log( (k + 0.5) / (M - k - 0.5) );
+  }
+
+  #pragma omp parallel for
+  for (int i=0; i<N; i++)
+  { double x = (omega[i] + shift - a) / h - 0.5;
+    int k = (int) floor(x);
+    if (k < 0) k = 0;
+    if (k > M-2) k = M-2;
+    double s = x - k;
+    G[i] = complex<double>( (1-s) * ReG[k] + s * ReG[k+1],
+                            -pi * interpl(N, dos, omega, omega[i] + shift) );
+  }
+
+  delete [] e;
+  delete [] D;
+  delete [] f;
+  delete [] kernel;
+  delete [] ReG;
+  delete [] H;
+}
+
+//------ Gauss quadratures, from Num Recipes -----//
+
+void GaussLegendre(int N, double x1, double x2, double* x, double* w)
+{ //nodes x and weights w of the N-point Gauss-Legendre rule on [x1,x2], nodes in ascending order
+  double EPS = 3.0e-14;
+  int m = (N+1)/2;
+  double xm = 0.5*(x2+x1);
+  double xl = 0.5*(x2-x1);
+  for (int i=1; i<=m; i++)
+  { double z = cos(pi*(i-0.25)/(N+0.5));
+    double z1, p1, p2, p3, pp;
+    do
+    { p1 = 1.0;
+      p2 = 0.0;
+      for (int j=1; j<=N; j++)
+      { p3 = p2;
+        p2 = p1;
+        p1 = ((2.0*j-1.0)*z*p2 - (j-1.0)*p3)/j;
+      }
+      pp = N*(z*p1-p2)/(z*z-1.0);
+      z1 = z;
+      z = z1-p1/pp;
+    } while (fabs(z-z1) > EPS);
+    x[i-1] = xm - xl*z;
+    x[N-i] = xm + xl*z;
+    w[i-1] = 2.0*xl/((1.0-z*z)*pp*pp);
+    w[N-i] = w[i-1];
+  }
+}
+
+void GaussHermite(int N, double* x, double* w)
+{ //nodes x and weights w of the N-point Gauss-Hermite rule (weight function exp(-x^2)), nodes in ascending order
+  double EPS = 3.0e-14;
+  double PIM4 = 0.7511255444649425; //pi^(-1/4)
+  int MAXIT = 10;
+  int m = (N+1)/2;
+  double z, z1, p1, p2, p3, pp;
+  //roots come out in descending order, x[0] being the largest
+  for (int i=1; i<=m; i++)
+  { if (i==1) z = sqrt(2.0*N+1.0) - 1.85575*pow(2.0*N+1.0, -0.16667);
+    else if (i==2) z -= 1.14*pow((double)N, 0.426)/z;
+    else if (i==3) z = 1.86*z - 0.86*x[0];
+    else if (i==4) z = 1.91*z - 0.91*x[1];
+    else z = 2.0*z - x[i-3];
+    for (int its=0; its<MAXIT; its++)
+    { p1 = PIM4;
+      p2 = 0.0;
+      for (int j=1; j<=N; j++)
+      { p3 = p2;
+        p2 = p1;
+        p1 = z*sqrt(2.0/j)*p2 - sqrt((j-1.0)/j)*p3;
+      }
+      pp = sqrt(2.0*N)*p2;
+      z1 = z;
+      z = z1-p1/pp;
+      if (fabs(z-z1) <= EPS) break;
+    }
+    x[i-1] = z;
+    x[N-i] = -z;
+    w[i-1] = 2.0/(pp*pp);
+    w[N-i] = w[i-1];
+  }
+  //reverse to ascending order
+  for (int i=0; i<N/2; i++)
+  { double tmp = x[i]; x[i] = x[N-1-i]; x[N-1-i] = tmp;
+    tmp = w[i]; w[i] = w[N-1-i]; w[N-1-i] = tmp;
+  }
 }
 
 //------Sine Integral, from Num Recipes -----//
@@ -502,7 +766,6 @@ double DOS(int DOStype, double t, double om)
               double Res = -1.0/pi * TrapezIntegral(N,d,omega);
               delete [] d;
               delete [] omega;
-              grid.~GRID();
               return 1.0 / (2 * sqr(pi) * t) 
                      * Res;          
            }  break;
@@ -533,20 +796,16 @@ void ReadDosFromFile(const char* FN, int N, double* omega, double* DOS)
   int n,m;
   double** dos;
   ReadFunc(FN, n, m, dos);
-  for (int i = 0; i<N; i++)
-    DOS[i] = interpl(n, dos[1], dos[0], omega[i]);
-  for (int i=0; i<m; i++)
-    delete [] dos[i];
-  delete [] dos;
+  Resample(n, dos[1], dos[0], N, omega, DOS);
+  ReleaseFunc(dos);
 }
 
 double interpl(int N, double* Y, double* X, double x)
 {
   if ((x < X[0])or(x > X[N-1])) return 0;
   else
-  { int i;
-    for (i = 0; i < N; i++)
-      if (X[i]>x) break;
+  { int i = upper_bound(X, X+N, x) - X;
+    if (i == N) i = N-1;
     return Y[i-1] + (Y[i]-Y[i-1]) / (X[i]-X[i-1]) 
                                   * (x-X[i-1]);
   }    
@@ -554,11 +813,31 @@ double interpl(int N, double* Y, double* X, double x)
 
 //------------------------------------------------------------------------------//
 
-complex<double> LS_get_G(int DOStype, double t, complex<double> com)
-{
-  complex<double> root = sqrt ( sqr(com) - 4.0 * sqr(t) );
-  double sgn = sign(imag(root));
-  return ( com - sgn*root) / ( 2.0 * sqr(t) ) ;
+complex<double> LS_get_G(int DOStype, double t, complex<double> com, LatticeTable* table)
+{ //G(com) = int de DOS(e) / (com - e), retarded for Im com >= 0
+  switch (DOStype)
+  {
+    case DOStypes::SemiCircle:
+           {
+             complex<double> root = sqrt ( sqr(com) - 4.0 * sqr(t) );
+             double sgn = sign(imag(root));
+             return ( com - sgn*root) / ( 2.0 * sqr(t) ) ;
+           }
+    case DOStypes::Gaussian:
+           { //without the cutoff of DOS at 0.001
+             if (imag(com) < 0) return conj( LS_get_G(DOStype, t, conj(com)) );
+             return complex<double>(0.0, -sqrt(pi) / (2*t)) * Faddeeva( com / (2*t) );
+           }
+    case DOStypes::SquareLattice:
+           { //G = 2/(pi com) K(4t/com), the continuation from the upper half plane
+             if (imag(com) < 0) return conj( LS_get_G(DOStype, t, conj(com)) );
+             if (imag(com) == 0) com += complex<double>(0.0, 1e-300);
+             return 2.0 / (pi * com) * EllipticIntegralFirstKind( 4.0 * t / com );
+           }
+    case DOStypes::CubicLattice:
+             return ( (table != NULL) ? table : LatticeTable::Get(DOStype, t) )->get_G(com);
+    default: { printf("-- ERROR -- LS_get_G: DOStype %d not implemented!\n", DOStype); exit(1); }
+  }
 }
 
 void InitG(int DOStype, double t, int N, double* omega, complex<double>* G)
@@ -574,8 +853,14 @@ void InitG(int DOStype, double t, int N, complex<double>* omega, complex<double>
   switch (DOStype)
   {
      case DOStypes::SemiCircle:     
+     case DOStypes::Gaussian:
+     case DOStypes::SquareLattice:
+     case DOStypes::CubicLattice:
+     { LatticeTable* table = (DOStype == DOStypes::CubicLattice) ? LatticeTable::Get(DOStype, t) : NULL;
+       #pragma omp parallel for
        for (int i = 0; i<N; i++)
-         G[i] = LS_get_G(DOStype, t, omega[i]) ;
+         G[i] = LS_get_G(DOStype, t, omega[i], table) ;
+     }
        break;     
      default: printf("routines::InitG: NOT IMPLEMENTED!!!");
   }
@@ -585,6 +870,13 @@ void InitG(int DOStype, double t, int N, complex<double>* omega, complex<double>
 
 void InitDOS(int DOStype, double t, int N, double* omega, double* dos)
 {
+  if (LatticeTable::HasTable(DOStype))
+  { LatticeTable* table = LatticeTable::Get(DOStype, t);
+    for (int i=0; i<N; i++) dos[i] = table->get_DOS(omega[i]);
+    return;
+  }
+
+  #pragma omp parallel for schedule(dynamic)
   for (int i=0; i<N; i++) dos[i] = DOS(DOStype, t, omega[i]);
 }
 
@@ -599,51 +891,38 @@ void InitDelta(int DOStype,
                const char* FNDos)
 {  
   printf("-- INFO -- routines: Making Delta: t=%.3f\n",t);
-  // prepare dos
-  
+
+  bool DosFromFile = (FNDos != NULL) and (FNDos[0] != '\0');
+
+  //tabulated lattices come with their Hilbert transform
+  if ( LatticeTable::HasTable(DOStype) and (!DosFromFile) )
+  { LatticeTable* table = LatticeTable::Get(DOStype, t);
+    #pragma omp parallel for
+    for (int i=1; i<N-1; i++) Delta[i] = sqr(V) * table->get_G(mu + omega[i]);
+    Delta[0] = Delta[1];
+    Delta[N-1] = Delta[N-2];
+    printf("-- INFO -- routines: Intgral Delta: %.6f\n", imag(TrapezIntegral(N,Delta,omega)));
+    return;
+  }
 //------------------Get DOS----------------------//
   double* dos = new double[N];
-
-
-// TODO : THIS NEEDS TO BE FIXED
-
-//  if (FNDos=="")
-    for(int i=0; i<N; i++)
+  if (DosFromFile)
+    ReadDosFromFile(FNDos, N, omega, dos);
+  else
+  {
+    #pragma omp parallel for schedule(dynamic)
+    for (int i=0; i<N; i++)
       dos[i] = DOS(DOStype, t, omega[i]);
-//  else
-//    ReadDosFromFile(FNDos, N, omega, dos);
-
-  //PrintFunc("InitDelta.DOS",N,dos,omega);
-  
-//-----------------------------------------------//
-  for (int i=1; i<N-1; i++)
-  {  
-    //treat integrand carefully
-    double D = 0.0;
-    complex<double> LogTerm = 0.0;
-    D = dos[i];
-
-    LogTerm =  ((i==0)or(i==N-1)) ? 0.0 
-                                  : complex<double>(D, 0.0) * log( complex<double> ( (mu + omega[i] + omega[N-1])
-                                                                                    /(mu + omega[i] - omega[N-1]) ) );
-    //printf("LogTerm(%.3f) = %.3f, %.3f\n",omega[i], real(LogTerm),imag(LogTerm));
-    //create integrand array
-    complex<double>* d = new complex<double>[N];
-    for (int j=0; j<N; j++)
-    {  d[j] = (i==j) ? 0.0 : complex<double>(dos[j] - D, 0.0) 
-                            / complex<double>( mu + omega[i] - omega[j] ); 
-       //if (i==j) printf("d(i=j) = %.3f, %.3f\n", real(d[j]), imag(d[j]) );
-    }
-      
-    //integrate to get G 
-    Delta[i] = conj( sqr(V)*(TrapezIntegral(N, d,omega) + LogTerm) ) ; 
-    delete [] d; 
   }
+  if (DOStype == DOStypes::FromFileSymmetric)
+    for (int i=0; i<N/2; i++)
+      dos[i] = dos[N-1-i] = 0.5 * (dos[i] + dos[N-1-i]);
+//-----------------------------------------------//
+
+  HilbertTransform(N, omega, dos, mu, Delta);
+  for (int i=1; i<N-1; i++) Delta[i] *= sqr(V);
   Delta[0] = Delta[1];
   Delta[N-1] = Delta[N-2];
-  //PrintFunc("DeltaMade",N,Delta,omega);
-
-//---------------------------------------------------------------------------//
 
   delete [] dos;
   printf("-- INFO -- routines: Intgral Delta: %.6f\n", imag(TrapezIntegral(N,Delta,omega)));
@@ -654,12 +933,15 @@ void InitDeltaFromSIAMOutputFile(const char* FN, int N, double* omega, complex<d
   int n,m;
   double** output;
   ReadFunc(FN, n, m, output);
+  double* ReDelta = new double[N];
+  double* ImDelta = new double[N];
+  Resample(n, output[2], output[0], N, omega, ReDelta);
+  Resample(n, output[3], output[0], N, omega, ImDelta);
   for (int i = 0; i<N; i++)
-    Delta[i] = complex<double>( interpl(n, output[2], output[0], omega[i]), 
-                              interpl(n, output[3], output[0], omega[i]) );
-  for (int i=0; i<m; i++)
-    delete [] output[i];
-  delete [] output;
+    Delta[i] = complex<double>(ReDelta[i], ImDelta[i]);
+  delete [] ReDelta;
+  delete [] ImDelta;
+  ReleaseFunc(output);
 }
 
 void InitInsulatorDelta(double U,
@@ -3,6 +3,8 @@
 
 using namespace std;
 
+class LatticeTable;
+
 //======================== CONSTANTS ===============================//
 
 const double pi = 3.14159265358979323846;
@@ -15,6 +17,8 @@ double sign(double x);
 double sqr(double x);
 int pow(int base, int exp);
 complex<double> sqr(complex<double> x);
+double Fermi(double omega, double T);		//1/(1+exp(omega/T)), no overflow for large omega/T
+void Fermi(int N, const double* omega, double T, double* f);
 /*double abs(double x);*/
 /*double abs(complex<double> x);*/
 
@@ -22,13 +26,24 @@ complex<double> sqr(complex<double> x);
 
 double TrapezIntegral(int N, double Y[], double X[]);
 complex<double> TrapezIntegral(int N, complex<double> Y[], double X[]);
+void TrapezWeights(int N, double* X, double* w);
+double WeightedSum(int N, const double* w, const double* Y);	//deterministic for any number of threads
+complex<double> WeightedSum(int N, const double* w, const complex<double>* Y);
 double TrapezIntegralMP(int N, double Y[], double X[]);
 complex<double> TrapezIntegralMP(int N, complex<double> Y[], double X[]);
 //double TrapezIntegral(std::vector< double > Y, std::vector<double> X);
 complex<double> TrapezIntegral(std::vector< complex<double> > Y, std::vector<double> X);
+double AGM(double a, double b);
+complex<double> AGM(complex<double> a, complex<double> b);
 double EllipticIntegralFirstKind(double x);
 double SI(double x);
+void GaussLegendre(int N, double x1, double x2, double* x, double* w);
+void GaussHermite(int N, double* x, double* w);
 complex<double> EllipticIntegralFirstKind(complex<double> x);
+complex<double> Faddeeva(complex<double> z);	//w(z) = exp(-z^2) erfc(-iz), Im z >= 0
+complex<double> Digamma(complex<double> z);
+void FFT(int N, complex<double>* a, bool inverse);	//N a power of 2, unnormalized
+void HilbertTransform(int N, double* omega, double* dos, double shift, complex<double>* G);
 double interpl(int N, double* Y, double* X, double x);
 
 //======================== IO =======================================//
@@ -41,6 +56,8 @@ void PrintFunc(const char* FileName, int N, double* Y, double* X);
 void PrintFunc(const char* FileName, std::vector< complex<double> > Y, std::vector<double> X);
 void PrintFunc3D(const char* FileName, int N, complex<double>** Y, double* X);
 void ReadFunc(const char* FileName, int &N, int &M, double** &X);
+void ReleaseFunc(double** X);
+void Resample(int n, double* Y, double* X, int N, double* x, double* y);
 
 //===================vectors and matrices=============================//
 
@@ -68,7 +85,8 @@ double DOS(int DOStype, double t, double om);
 void WriteCubicDosToFile();
 void ReadDosFromFile(const char* FN, int N, double* omega, double* DOS);
 
-complex<double> LS_get_G(int DOStype, double t, complex<double> com);
+//table is the LatticeTable of a CubicLattice, looked up if NULL
+complex<double> LS_get_G(int DOStype, double t, complex<double> com, LatticeTable* table = NULL);
 void InitG(int DOStype, double t, int N, double* omega, complex<double>* G);
 void InitG(int DOStype, double t, int N, complex<double>* omega, complex<double>* G);
 